@@ -0,0 +1,46 @@
+#include "authStore.h"
+#include "sqliteAuthStore.h"
+#include "memoryAuthStore.h"
+
+#ifdef WITH_MYSQL
+#include "mysqlAuthStore.h"
+#endif
+
+std::unique_ptr<AuthStore> AuthStore::s_store;
+
+bool AuthStore::init(const AuthConfig& config) {
+    switch (config._backend) {
+        case _AUTH_SQLITE:
+            s_store = std::make_unique<SqliteAuthStore>(config._sqlitePath);
+            break;
+        case _AUTH_MEMORY:
+            s_store = std::make_unique<MemoryAuthStore>(config._shards);
+            break;
+        default:
+#ifdef WITH_MYSQL
+            s_store = std::make_unique<MySqlAuthStore>();
+            break;
+#else
+            Logger::Instance()->LOG_ERROR("auth store open failed: built without mysql");
+            return false;
+#endif
+    }
+
+    if (!s_store->open()) {
+        std::string msg = std::string("auth store open failed: ") + s_store->name();
+        Logger::Instance()->LOG_ERROR(msg);
+
+        s_store.reset();
+        return false;
+    }
+
+    return true;
+}
+
+AuthStore* AuthStore::Instance() {
+    return s_store.get();
+}
+
+void AuthStore::destroy() {
+    s_store.reset();
+}
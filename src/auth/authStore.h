@@ -0,0 +1,53 @@
+/*
+    账户存储接口
+    登录注册只依赖该接口，后端由配置选择: MySQL / SQLite文件 / 进程内存
+*/
+
+#ifndef _AUTH_STORE_H
+#define _AUTH_STORE_H
+
+#include <string>
+#include <memory>
+
+#include "../config/serverConfig.h"
+#include "../logger/logger.h"
+
+// 账户操作结果
+enum AUTH_RESULT {
+    _AUTH_OK,
+    _AUTH_DENIED,       // 用户不存在、密码不符或用户已存在
+    _AUTH_UNAVAILABLE   // 后端不可用(出错、超时、熔断)，与账户本身无关
+};
+
+class AuthStore {
+public:
+    virtual ~AuthStore() = default;
+
+    /**
+     * @brief 按配置创建后端，MySQL 后端须先初始化数据库连接池；未以 WITH_MYSQL 构建时 MySQL 后端不可用
+     *
+     * @return false 后端打开失败
+     */
+    static bool init(const AuthConfig& config);
+    static AuthStore* Instance();
+    static void destroy();
+
+public:
+    virtual bool open() = 0;
+
+    // 用户存在且密码一致时为 _AUTH_OK
+    virtual AUTH_RESULT verify(const std::string& user, const std::string& password) = 0;
+
+    // 用户已存在时为 _AUTH_DENIED
+    virtual AUTH_RESULT add(const std::string& user, const std::string& password) = 0;
+
+    // 访问是否会阻塞(涉及磁盘或网络)，阻塞的后端由数据库线程访问
+    virtual bool blocking() const = 0;
+
+    virtual const char* name() const = 0;
+
+private:
+    static std::unique_ptr<AuthStore> s_store;
+};
+
+#endif  // _AUTH_STORE_H
@@ -0,0 +1,52 @@
+#include "bloomFilter.h"
+
+#include <functional>
+
+BloomFilter::BloomFilter(size_t bits, int hashes)
+    :m_hashes(hashes > 0 ? hashes : 1) {
+    size_t size = 64;
+    while (size < bits)
+        size <<= 1;
+
+    m_words = std::make_unique<std::atomic<uint64_t>[]>(size / 64);
+    for (size_t i = 0; i < size / 64; i++)
+        m_words[i].store(0, std::memory_order_relaxed);
+
+    m_mask = size - 1;
+}
+
+void BloomFilter::add(std::string_view key) {
+    uint64_t h1, h2;
+    hash(key, h1, h2);
+
+    for (int i = 0; i < m_hashes; i++) {
+        size_t bit = (h1 + i * h2) & m_mask;
+        m_words[bit >> 6].fetch_or(uint64_t(1) << (bit & 63), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @return false 一定未加入过
+ */
+bool BloomFilter::mayContain(std::string_view key) const {
+    uint64_t h1, h2;
+    hash(key, h1, h2);
+
+    for (int i = 0; i < m_hashes; i++) {
+        size_t bit = (h1 + i * h2) & m_mask;
+        if (!(m_words[bit >> 6].load(std::memory_order_relaxed) & (uint64_t(1) << (bit & 63))))
+            return false;
+    }
+
+    return true;
+}
+
+void BloomFilter::hash(std::string_view key, uint64_t& h1, uint64_t& h2) {
+    h1 = std::hash<std::string_view>()(key);
+
+    // splitmix64 混合出第二个值，取奇数保证步长与2的幂长度互素
+    uint64_t z = h1 + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    h2 = (z ^ (z >> 31)) | 1;
+}
@@ -0,0 +1,39 @@
+/*
+    布隆过滤器: 判断元素"一定不存在"或"可能存在"
+    位数组由原子字操作读写，加入与查询可并发进行，无需加锁；不支持删除
+*/
+
+#ifndef _BLOOM_FILTER_H
+#define _BLOOM_FILTER_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <string_view>
+
+class BloomFilter {
+public:
+    /**
+     * @param bits   位数组长度，向上取整为2的幂
+     * @param hashes 每个元素置位的个数
+     */
+    BloomFilter(size_t bits, int hashes);
+    ~BloomFilter() = default;
+
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+
+public:
+    void add(std::string_view key);
+    bool mayContain(std::string_view key) const;
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+    size_t m_mask;      // 位下标掩码
+    int m_hashes;
+
+    // 由一次哈希派生出的两个值，第 i 个位置为 h1 + i * h2
+    static void hash(std::string_view key, uint64_t& h1, uint64_t& h2);
+};
+
+#endif  // _BLOOM_FILTER_H
@@ -0,0 +1,36 @@
+#include "memoryAuthStore.h"
+
+MemoryAuthStore::MemoryAuthStore(int shardNums)
+    :m_shards(shardNums > 0 ? shardNums : 1) {}
+
+bool MemoryAuthStore::open() {
+    return true;
+}
+
+AUTH_RESULT MemoryAuthStore::verify(const std::string& user, const std::string& password) {
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+
+    auto it = shard.users.find(user);
+    return it != shard.users.end() && it->second == password ? _AUTH_OK : _AUTH_DENIED;
+}
+
+AUTH_RESULT MemoryAuthStore::add(const std::string& user, const std::string& password) {
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+
+    return shard.users.try_emplace(user, password).second ? _AUTH_OK : _AUTH_DENIED;
+}
+
+// 不涉及io，处理函数直接在循环线程内执行
+bool MemoryAuthStore::blocking() const {
+    return false;
+}
+
+const char* MemoryAuthStore::name() const {
+    return "memory";
+}
+
+MemoryAuthStore::Shard& MemoryAuthStore::shardOf(const std::string& user) {
+    return m_shards[std::hash<std::string>()(user) % m_shards.size()];
+}
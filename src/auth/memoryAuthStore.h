@@ -0,0 +1,39 @@
+/*
+    进程内账户存储: 按用户名哈希分片的哈希表，各分片独立加锁
+    数据不落盘，用于在无数据库的环境中压测完整的登录注册路径
+*/
+
+#ifndef _MEMORY_AUTH_STORE_H
+#define _MEMORY_AUTH_STORE_H
+
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#include "authStore.h"
+
+class MemoryAuthStore: public AuthStore {
+public:
+    explicit MemoryAuthStore(int shardNums);
+    ~MemoryAuthStore() override = default;
+
+public:
+    bool open() override;
+    AUTH_RESULT verify(const std::string& user, const std::string& password) override;
+    AUTH_RESULT add(const std::string& user, const std::string& password) override;
+    bool blocking() const override;
+    const char* name() const override;
+
+private:
+    // 各分片独占缓存行，避免相邻分片的锁相互干扰
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::string> users;
+    };
+
+    std::vector<Shard> m_shards;
+
+    Shard& shardOf(const std::string& user);
+};
+
+#endif  // _MEMORY_AUTH_STORE_H
@@ -0,0 +1,350 @@
+#include "mysqlAuthStore.h"
+
+MySqlAuthStore::MySqlAuthStore()
+    :m_users(USER_FILTER_BITS, USER_FILTER_HASHES), m_usersLoaded(false), m_loaderStop(false), m_collecting(false) {}
+
+MySqlAuthStore::~MySqlAuthStore() {
+    {
+        std::lock_guard<std::mutex> locker(m_loaderMutex);
+        m_loaderStop = true;
+    }
+    m_loaderCond.notify_all();
+
+    if (m_loader.joinable())
+        m_loader.join();
+}
+
+/**
+ * @brief 连接池由服务初始化并在后台建立连接，数据库暂不可用时账户请求失败，不阻止服务启动
+ *        用户名过滤器同样在后台载入
+ */
+bool MySqlAuthStore::open() {
+    m_loader = std::thread(&MySqlAuthStore::loadUsers, this);
+    return true;
+}
+
+/**
+ * @brief 取不到连接(超时、熔断或数据库不可用)时不阻塞调用线程，结果为不可用
+ */
+AUTH_RESULT MySqlAuthStore::verify(const std::string& usr, const std::string& psw) {
+    AUTH_RESULT result = _AUTH_DENIED;
+
+    if (absent(usr))
+        return _AUTH_DENIED;
+
+    SqlConnGuard conn;
+    if (!conn)
+        return _AUTH_UNAVAILABLE;
+
+    MYSQL_STMT* stmt = conn.stmt(_SELECT_PASSWORD);
+    if (!stmt)
+        return _AUTH_UNAVAILABLE;
+
+    // 执行出错多为连接断开，归还时关闭
+    if (!SqlConnPool::execute(stmt, { usr })) {
+        conn.invalidate();
+        return _AUTH_UNAVAILABLE;
+    }
+
+    char password[MAX_PASSWORD_LEN];
+    unsigned long length = 0;
+
+    MYSQL_BIND bind = {};
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = password;
+    bind.buffer_length = sizeof(password);
+    bind.length = &length;
+
+    // 密码超长时 fetch 返回 MYSQL_DATA_TRUNCATED，视为不匹配
+    if (!mysql_stmt_bind_result(stmt, &bind) && !mysql_stmt_store_result(stmt) && mysql_stmt_fetch(stmt) == 0 &&
+        std::string_view(password, length) == psw)
+        result = _AUTH_OK;
+
+    mysql_stmt_free_result(stmt);
+
+    return result;
+}
+
+/**
+ * @brief 查重后经批量提交写入，查重期间持有的连接在等待批量前归还
+ */
+AUTH_RESULT MySqlAuthStore::add(const std::string& usr, const std::string& psw) {
+    // 过滤器判定不存在时省去查重
+    if (!absent(usr)) {
+        SqlConnGuard conn;
+        if (!conn)
+            return _AUTH_UNAVAILABLE;
+
+        MYSQL_STMT* select = conn.stmt(_SELECT_PASSWORD);
+        if (!select)
+            return _AUTH_UNAVAILABLE;
+
+        if (!SqlConnPool::execute(select, { usr })) {
+            conn.invalidate();
+            return _AUTH_UNAVAILABLE;
+        }
+
+        bool exists = !mysql_stmt_store_result(select) && mysql_stmt_num_rows(select) > 0;
+        mysql_stmt_free_result(select);
+
+        if (exists)
+            return _AUTH_DENIED;
+    }
+
+    return insertBatched(usr, psw);
+}
+
+bool MySqlAuthStore::blocking() const {
+    return true;
+}
+
+const char* MySqlAuthStore::name() const {
+    return "mysql";
+}
+
+/**
+ * @brief 载入线程: 失败后按指数退避重试，直至成功或析构；载入成功前过滤器不启用
+ */
+void MySqlAuthStore::loadUsers() {
+    int retryMS = USER_FILTER_RETRY_MS;
+
+    while (!m_loaderStop && !tryLoadUsers()) {
+        std::string msg = "user filter load failed, retry in " + std::to_string(retryMS) + "ms";
+        Logger::Instance()->LOG_WARNING(msg);
+
+        std::unique_lock<std::mutex> locker(m_loaderMutex);
+        m_loaderCond.wait_for(locker, std::chrono::milliseconds(retryMS), [this] { return m_loaderStop.load(); });
+
+        retryMS = std::min(retryMS * 2, USER_FILTER_RETRY_MAX_MS);
+    }
+}
+
+/**
+ * @brief 从 login 表逐行读取全部用户名加入过滤器，成功后过滤器生效
+ *        全表扫描耗时长，直接向连接池取连接，不经熔断器计入慢调用
+ */
+bool MySqlAuthStore::tryLoadUsers() {
+    SqlConnPool* pool = SqlConnPool::Instance();
+
+    MYSQL* conn = pool->getConn(USER_FILTER_LOAD_TIMEOUT_MS);
+    if (!conn)
+        return false;
+
+    if (mysql_query(conn, "SELECT username FROM login")) {
+        std::string msg = "user filter load error: " + std::string(mysql_error(conn));
+        Logger::Instance()->LOG_WARNING(msg);
+
+        pool->freeConn(conn);
+        return false;
+    }
+
+    // 逐行读取，不在客户端缓存整个结果集
+    MYSQL_RES* res = mysql_use_result(conn);
+    if (!res) {
+        pool->freeConn(conn, true);
+        return false;
+    }
+
+    size_t count = 0;
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        unsigned long* lengths = mysql_fetch_lengths(res);
+        m_users.add(std::string_view(row[0], lengths[0]));
+        count++;
+    }
+
+    // 读取中途出错时结果不完整；已加入的用户名只会造成误判存在，不影响正确性
+    bool complete = mysql_errno(conn) == 0;
+    mysql_free_result(res);
+
+    if (complete)
+        checkUniqueIndex(conn);
+
+    pool->freeConn(conn, !complete);
+
+    if (!complete)
+        return false;
+
+    m_usersLoaded.store(true, std::memory_order_release);
+
+    std::string msg = "user filter loaded: " + std::to_string(count);
+    Logger::Instance()->LOG_INFO(msg);
+
+    return true;
+}
+
+/**
+ * @brief 查重与写入之间存在间隙(并发注册、批量提交)，用户名重复只能由唯一索引拒绝，缺少时告警
+ */
+void MySqlAuthStore::checkUniqueIndex(MYSQL* conn) {
+    if (mysql_query(conn, "SHOW INDEX FROM login WHERE Column_name = 'username' AND Non_unique = 0")) {
+        std::string msg = "username unique index check error: " + std::string(mysql_error(conn));
+        Logger::Instance()->LOG_WARNING(msg);
+        return;
+    }
+
+    MYSQL_RES* res = mysql_store_result(conn);
+    if (!res)
+        return;
+
+    bool found = mysql_num_rows(res) > 0;
+    mysql_free_result(res);
+
+    if (!found)
+        Logger::Instance()->LOG_WARNING("login.username has no unique index, concurrent registrations may duplicate users: ALTER TABLE login ADD UNIQUE (username)");
+}
+
+/**
+ * @brief 用户名一定未注册
+ */
+bool MySqlAuthStore::absent(const std::string& user) const {
+    return m_usersLoaded.load(std::memory_order_acquire) && !m_users.mayContain(user);
+}
+
+/**
+ * @brief 批量提交: 批次中第一个到达的调用者作为提交者，收集 REGISTER_BATCH_WAIT_MS 内
+ *        或至多 REGISTER_BATCH_MAX 个注册后在一个事务内写入；其余调用者等待各自的结果
+ *        提交期间新到达的注册组成下一批，由新的提交者在另一连接上并行提交
+ */
+AUTH_RESULT MySqlAuthStore::insertBatched(const std::string& usr, const std::string& psw) {
+    PendingUser self = { &usr, &psw, false, _AUTH_UNAVAILABLE };
+
+    std::unique_lock<std::mutex> locker(m_batchMutex);
+    m_pending.push_back(&self);
+
+    if (m_collecting) {
+        if (m_pending.size() >= REGISTER_BATCH_MAX)
+            m_batchFullCond.notify_one();
+
+        m_batchDoneCond.wait(locker, [&self] { return self.done; });
+        return self.result;
+    }
+
+    m_collecting = true;
+    m_batchFullCond.wait_for(locker, std::chrono::milliseconds(REGISTER_BATCH_WAIT_MS), [this] {
+        return m_pending.size() >= REGISTER_BATCH_MAX;
+    });
+
+    std::vector<PendingUser*> batch;
+    batch.swap(m_pending);
+    m_collecting = false;
+    locker.unlock();
+
+    // 同批内重名时只写入首个，其余与已存在同样处理
+    std::unordered_set<std::string_view> names;
+    std::vector<PendingUser*> distinct;
+    for (PendingUser* pending : batch) {
+        if (names.insert(*pending->user).second)
+            distinct.push_back(pending);
+        else
+            pending->result = _AUTH_DENIED;
+    }
+
+    commitUsers(distinct);
+
+    locker.lock();
+    for (PendingUser* pending : batch)
+        pending->done = true;
+    locker.unlock();
+
+    m_batchDoneCond.notify_all();
+    return self.result;
+}
+
+/**
+ * @brief 整批以一条多行插入写入，一次往返、一次落盘
+ *        批内有用户名已存在时整条语句不生效，改为逐条插入以区分各自的结果
+ *        各结果初始为不可用，未写入成功的保持不变
+ */
+void MySqlAuthStore::commitUsers(std::vector<PendingUser*>& batch) {
+    SqlConnGuard conn;
+    if (!conn)
+        return;
+
+    std::string sql = "INSERT INTO login(username, password) VALUES";
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        sql += i == 0 ? "('" : ",('";
+        appendEscaped(conn.get(), *batch[i]->user, sql);
+        sql += "','";
+        appendEscaped(conn.get(), *batch[i]->password, sql);
+        sql += "')";
+    }
+
+    if (mysql_real_query(conn.get(), sql.data(), sql.size()) == 0) {
+        for (PendingUser* pending : batch) {
+            pending->result = _AUTH_OK;
+            m_users.add(*pending->user);
+        }
+        return;
+    }
+
+    if (mysql_errno(conn.get()) != ER_DUP_ENTRY) {
+        std::string msg = "register batch insert error: " + std::string(mysql_error(conn.get()));
+        Logger::Instance()->LOG_ERROR(msg);
+
+        conn.invalidate();
+        return;
+    }
+
+    insertEach(conn, batch);
+}
+
+/**
+ * @brief 一个事务内逐条执行预编译的插入语句，整批只提交一次
+ *        用户名冲突只回滚该条；其他出错或提交失败时整批失败
+ */
+void MySqlAuthStore::insertEach(SqlConnGuard& conn, std::vector<PendingUser*>& batch) {
+    MYSQL_STMT* insert = conn.stmt(_INSERT_USER);
+    if (!insert)
+        return;
+
+    if (mysql_autocommit(conn.get(), false)) {
+        conn.invalidate();
+        return;
+    }
+
+    bool failed = false;
+
+    for (PendingUser* pending : batch) {
+        if (SqlConnPool::execute(insert, { *pending->user, *pending->password }))
+            pending->result = _AUTH_OK;
+        else if (mysql_stmt_errno(insert) == ER_DUP_ENTRY)
+            pending->result = _AUTH_DENIED;     // 用户名冲突只影响该条
+        else {
+            failed = true;                      // 其余错误(如连接断开、超时)整批失败
+            break;
+        }
+    }
+
+    if (failed || mysql_commit(conn.get())) {
+        std::string msg = "register batch commit error: " + std::string(mysql_error(conn.get()));
+        Logger::Instance()->LOG_ERROR(msg);
+
+        mysql_rollback(conn.get());
+        conn.invalidate();
+
+        for (PendingUser* pending : batch)
+            pending->result = _AUTH_UNAVAILABLE;
+        return;
+    }
+
+    // 连接归还后供其他语句使用，须恢复自动提交
+    if (mysql_autocommit(conn.get(), true))
+        conn.invalidate();
+
+    for (PendingUser* pending : batch) {
+        if (pending->result == _AUTH_OK)
+            m_users.add(*pending->user);
+    }
+}
+
+/**
+ * @brief 按连接的字符集转义后追加到语句中(引号由调用方添加)
+ */
+void MySqlAuthStore::appendEscaped(MYSQL* conn, const std::string& value, std::string& sql) {
+    size_t pos = sql.size();
+    sql.resize(pos + value.size() * 2 + 1);
+
+    unsigned long len = mysql_real_escape_string(conn, &sql[pos], value.data(), value.size());
+    sql.resize(pos + len);
+}
@@ -0,0 +1,81 @@
+/*
+    MySQL 账户存储: 经数据库连接池上缓存的预编译语句访问 login 表
+    已注册用户名另存于内存中的布隆过滤器，启动后由后台线程从 login 表载入，注册成功时加入；
+    载入完成后，过滤器判定不存在的用户名登录时直接失败、注册时省去查重，不访问数据库
+    过滤器只反映本进程所见的注册，多个服务进程共用一个库时不适用
+    并发的注册合并为一条多行插入提交(group commit)，一批只落盘一次
+*/
+
+#ifndef _MYSQL_AUTH_STORE_H
+#define _MYSQL_AUTH_STORE_H
+
+#include <string_view>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <mysql/mysql.h>
+#include <mysql/mysqld_error.h>
+
+#include "authStore.h"
+#include "bloomFilter.h"
+#include "../pool/sqlConnPool.h"
+
+#define MAX_PASSWORD_LEN            256         // 读取已存密码的缓冲区长度
+#define USER_FILTER_BITS            (1 << 24)   // 用户名过滤器位数(2MB)，百万用户时误判率约 0.06%
+#define USER_FILTER_HASHES          7
+#define USER_FILTER_LOAD_TIMEOUT_MS 1000        // 载入时取连接的等待上限，过长会拖慢退出
+#define USER_FILTER_RETRY_MS        1000        // 载入失败后的首次重试间隔，此后逐次翻倍
+#define USER_FILTER_RETRY_MAX_MS    60000       // 重试间隔上限
+#define REGISTER_BATCH_MAX          32          // 一次提交的注册数上限
+#define REGISTER_BATCH_WAIT_MS      2           // 提交者收集同批注册的时长
+
+class MySqlAuthStore: public AuthStore {
+public:
+    MySqlAuthStore();
+    ~MySqlAuthStore() override;
+
+public:
+    bool open() override;
+    AUTH_RESULT verify(const std::string& user, const std::string& password) override;
+    AUTH_RESULT add(const std::string& user, const std::string& password) override;
+    bool blocking() const override;
+    const char* name() const override;
+
+private:
+    BloomFilter m_users;
+    std::atomic<bool> m_usersLoaded;    // 载入完成前过滤器不完整，不可据以判定不存在
+    std::thread m_loader;
+    std::atomic<bool> m_loaderStop;
+    std::mutex m_loaderMutex;
+    std::condition_variable m_loaderCond;   // 析构时打断重试等待
+
+    // 等待批量提交的注册，结果由提交者填写
+    struct PendingUser {
+        const std::string* user;
+        const std::string* password;
+        bool done;
+        AUTH_RESULT result;
+    };
+
+    std::vector<PendingUser*> m_pending;
+    bool m_collecting;                  // 已有提交者在收集当前批次
+    std::mutex m_batchMutex;
+    std::condition_variable m_batchFullCond;
+    std::condition_variable m_batchDoneCond;
+
+    void loadUsers();
+    bool tryLoadUsers();
+    void checkUniqueIndex(MYSQL* conn);
+    bool absent(const std::string& user) const;
+    AUTH_RESULT insertBatched(const std::string& user, const std::string& password);
+    void commitUsers(std::vector<PendingUser*>& batch);
+    void insertEach(SqlConnGuard& conn, std::vector<PendingUser*>& batch);
+    static void appendEscaped(MYSQL* conn, const std::string& value, std::string& sql);
+};
+
+#endif  // _MYSQL_AUTH_STORE_H
@@ -0,0 +1,95 @@
+#include "sqliteAuthStore.h"
+
+SqliteAuthStore::SqliteAuthStore(const std::string& path)
+    :m_path(path), m_db(nullptr), m_select(nullptr), m_insert(nullptr) {}
+
+SqliteAuthStore::~SqliteAuthStore() {
+    sqlite3_finalize(m_select);
+    sqlite3_finalize(m_insert);
+    sqlite3_close(m_db);
+}
+
+/**
+ * @brief 打开(不存在时创建)数据库文件与 login 表，并预编译语句
+ */
+bool SqliteAuthStore::open() {
+    if (sqlite3_open_v2(m_path.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        logError("open");
+        return false;
+    }
+
+    const char* schema =
+        "PRAGMA journal_mode = WAL;"
+        "PRAGMA synchronous = NORMAL;"
+        "CREATE TABLE IF NOT EXISTS login(username TEXT PRIMARY KEY, password TEXT NOT NULL);";
+
+    if (sqlite3_exec(m_db, schema, nullptr, nullptr, nullptr) != SQLITE_OK) {
+        logError("create table");
+        return false;
+    }
+
+    if (sqlite3_prepare_v2(m_db, "SELECT password FROM login WHERE username = ?", -1, &m_select, nullptr) != SQLITE_OK
+        || sqlite3_prepare_v2(m_db, "INSERT OR IGNORE INTO login(username, password) VALUES(?, ?)", -1, &m_insert, nullptr) != SQLITE_OK) {
+        logError("prepare");
+        return false;
+    }
+
+    return true;
+}
+
+AUTH_RESULT SqliteAuthStore::verify(const std::string& user, const std::string& password) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    AUTH_RESULT result = _AUTH_DENIED;
+
+    sqlite3_bind_text(m_select, 1, user.data(), user.size(), SQLITE_STATIC);
+
+    int rc = sqlite3_step(m_select);
+    if (rc == SQLITE_ROW) {
+        const char* stored = reinterpret_cast<const char*>(sqlite3_column_text(m_select, 0));
+        if (stored && password == std::string_view(stored, sqlite3_column_bytes(m_select, 0)))
+            result = _AUTH_OK;
+    }
+    else if (rc != SQLITE_DONE) {
+        logError("select");
+        result = _AUTH_UNAVAILABLE;
+    }
+
+    sqlite3_reset(m_select);
+    sqlite3_clear_bindings(m_select);
+
+    return result;
+}
+
+AUTH_RESULT SqliteAuthStore::add(const std::string& user, const std::string& password) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+
+    sqlite3_bind_text(m_insert, 1, user.data(), user.size(), SQLITE_STATIC);
+    sqlite3_bind_text(m_insert, 2, password.data(), password.size(), SQLITE_STATIC);
+
+    // 用户已存在时 INSERT OR IGNORE 不改动任何行
+    int rc = sqlite3_step(m_insert);
+    AUTH_RESULT result = sqlite3_changes(m_db) == 1 ? _AUTH_OK : _AUTH_DENIED;
+
+    if (rc != SQLITE_DONE) {
+        logError("insert");
+        result = _AUTH_UNAVAILABLE;
+    }
+
+    sqlite3_reset(m_insert);
+    sqlite3_clear_bindings(m_insert);
+
+    return result;
+}
+
+bool SqliteAuthStore::blocking() const {
+    return true;
+}
+
+const char* SqliteAuthStore::name() const {
+    return "sqlite";
+}
+
+void SqliteAuthStore::logError(const char* what) const {
+    std::string msg = "sqlite " + std::string(what) + " error: " + (m_db ? sqlite3_errmsg(m_db) : "out of memory") + " - " + m_path;
+    Logger::Instance()->LOG_ERROR(msg);
+}
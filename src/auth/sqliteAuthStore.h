@@ -0,0 +1,37 @@
+/*
+    SQLite 账户存储: 单个数据库文件，无需数据库服务
+    一个连接由互斥锁保护，语句在打开时预编译；WAL 模式下读写互不阻塞文件
+*/
+
+#ifndef _SQLITE_AUTH_STORE_H
+#define _SQLITE_AUTH_STORE_H
+
+#include <mutex>
+#include <string_view>
+#include <sqlite3.h>
+
+#include "authStore.h"
+
+class SqliteAuthStore: public AuthStore {
+public:
+    explicit SqliteAuthStore(const std::string& path);
+    ~SqliteAuthStore() override;
+
+public:
+    bool open() override;
+    AUTH_RESULT verify(const std::string& user, const std::string& password) override;
+    AUTH_RESULT add(const std::string& user, const std::string& password) override;
+    bool blocking() const override;
+    const char* name() const override;
+
+private:
+    std::string m_path;
+    sqlite3* m_db;
+    sqlite3_stmt* m_select;
+    sqlite3_stmt* m_insert;
+    std::mutex m_mutex;
+
+    void logError(const char* what) const;
+};
+
+#endif  // _SQLITE_AUTH_STORE_H
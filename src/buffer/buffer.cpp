@@ -39,6 +39,15 @@ void Buffer::retrieveAll() {
     m_writePos = 0;
 }
 
+// 移除可读区内 [offset, offset + len) 的数据，其后的数据前移
+void Buffer::erase(size_t offset, size_t len) {
+    assert(offset + len <= readableBytes());
+
+    char* pos = begin() + m_readPos + offset;
+    std::copy(pos + len, begin() + m_writePos, pos);
+    m_writePos -= len;
+}
+
 void Buffer::hasWritten(size_t len) {
     assert(len > 0);
 
@@ -20,6 +20,7 @@ public:
     void retrieve(size_t len);
     void retrieveUntil(const char* end);
     void retrieveAll();
+    void erase(size_t offset, size_t len);
 
     void hasWritten(size_t len);
     void beenFilled();
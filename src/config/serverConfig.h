@@ -1,14 +1,58 @@
 #ifndef _SERVER_CONFIG_H
 #define _SERVER_CONFIG_H
 
-#include "../pool/sqlConnPool.h"
 #include "../logger/devices.h"
 
+#define SQL_CONNECT_TIMEOUT_S   3       // 建立连接的超时
+#define SQL_READ_TIMEOUT_S      3       // 单次读超时，客户端库出错时至多重试两次
+#define SQL_WRITE_TIMEOUT_S     3       // 单次写超时
+
 /**
- * @brief 数据库配置
+ * @brief 数据库配置，仅 MySQL 账户存储使用
  */
+struct SqlConnInfo {
+    int port;
+    const char* host;
+    const char* user;
+    const char* pwd;
+    const char* db_name;
+
+    // 秒，数据库无响应时语句在此时限内出错返回，不无限占用线程
+    unsigned int connect_timeout = SQL_CONNECT_TIMEOUT_S;
+    unsigned int read_timeout = SQL_READ_TIMEOUT_S;
+    unsigned int write_timeout = SQL_WRITE_TIMEOUT_S;
+};
+
 typedef SqlConnInfo SQLConfig;
 
+/**
+ * @brief io事件引擎
+ */
+enum IoEngine {
+    _EPOLL,
+    _IO_URING
+};
+
+/**
+ * @brief 监听socket配置
+ */
+struct ListenerConfig {
+    int _backlog;           // listen 全连接队列长度
+    int _deferAcceptSec;    // TCP_DEFER_ACCEPT: 客户端数据到达(或超时)后才完成accept; 0 - 关闭
+    int _fastOpenQlen;      // TCP_FASTOPEN 队列长度; 0 - 关闭
+    int _acceptBatch;       // 每轮事件循环最多accept的连接数，剩余连接留到下一轮
+
+    ListenerConfig() {
+        _backlog = 1024;
+        _deferAcceptSec = 0;
+        _fastOpenQlen = 0;
+        _acceptBatch = 64;
+    }
+
+    ListenerConfig(int backlog, int deferAcceptSec, int fastOpenQlen, int acceptBatch)
+        :_backlog(backlog), _deferAcceptSec(deferAcceptSec), _fastOpenQlen(fastOpenQlen), _acceptBatch(acceptBatch) {}
+};
+
 /**
  * @brief 基础配置
  */
@@ -17,16 +61,50 @@ struct BaseConfig {
     short _modeChoice;
     int _timeoutMS;
     bool _lingerUsing;
+    int _reactorNums;   // 0 - 单reactor + 线程池处理事务; N - N个reactor线程各自处理事务(SO_REUSEPORT)
+    IoEngine _ioEngine; // io_uring 不可用时退回 epoll
+    ListenerConfig _listener;
+    size_t _maxBodySize;    // 缓存于内存的请求体上限，超出以413响应；注册了流式处理函数的路径不受限
 
     BaseConfig() {
         _port = 7777;
         _modeChoice = 3;
         _timeoutMS = 60000;
         _lingerUsing = true;
+        _reactorNums = 0;
+        _ioEngine = _EPOLL;
+        _maxBodySize = 1 << 20;
+    }
+
+    BaseConfig(int port, short modeChoice, int timeoutMS, bool lingerUsing, int reactorNums = 0, IoEngine ioEngine = _EPOLL, ListenerConfig listener = ListenerConfig(), size_t maxBodySize = 1 << 20)
+        :_port(port), _modeChoice(modeChoice), _timeoutMS(timeoutMS), _lingerUsing(lingerUsing), _reactorNums(reactorNums), _ioEngine(ioEngine), _listener(listener), _maxBodySize(maxBodySize) {}
+};
+
+/**
+ * @brief 账户存储后端
+ */
+enum AuthBackend {
+    _AUTH_MYSQL,
+    _AUTH_SQLITE,   // 单文件数据库，无需数据库服务
+    _AUTH_MEMORY    // 进程内分片哈希表，重启后清空，用于压测
+};
+
+/**
+ * @brief 账户存储配置
+ */
+struct AuthConfig {
+    AuthBackend _backend;
+    const char* _sqlitePath;    // _AUTH_SQLITE 的数据库文件
+    int _shards;                // _AUTH_MEMORY 的分片数
+
+    AuthConfig() {
+        _backend = _AUTH_MYSQL;
+        _sqlitePath = "./auth.db";
+        _shards = 64;
     }
 
-    BaseConfig(int port, short modeChoice, int timeoutMS, bool lingerUsing)
-        :_port(port), _modeChoice(modeChoice), _timeoutMS(timeoutMS), _lingerUsing(lingerUsing) {}
+    AuthConfig(AuthBackend backend, const char* sqlitePath = "./auth.db", int shards = 64)
+        :_backend(backend), _sqlitePath(sqlitePath), _shards(shards) {}
 };
 
 /**
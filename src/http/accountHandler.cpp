@@ -0,0 +1,33 @@
+#include "accountHandler.h"
+
+int AccountHandler::handle(const HttpRequest& request, std::string& page) {
+    std::string user(request.formValue("username"));
+    std::string password(request.formValue("password"));
+
+    AUTH_RESULT result = request.formValue("isLogin") == "1" ? userLogin(user, password) : userRegister(user, password);
+
+    // 存储不可用(如数据库熔断)不能当作账户错误
+    if (result == _AUTH_UNAVAILABLE)
+        return 503;
+
+    page = result == _AUTH_OK ? "/welcome.html" : "/error.html";
+    return 200;
+}
+
+AUTH_RESULT AccountHandler::userLogin(const std::string& usr, const std::string& psw) {
+    if (usr == "" || psw == "") return _AUTH_DENIED;
+
+    std::string msg = "check login: " + usr;
+    Logger::Instance()->LOG_DEBUG(msg);
+
+    return AuthStore::Instance()->verify(usr, psw);
+}
+
+AUTH_RESULT AccountHandler::userRegister(const std::string& usr, const std::string& psw) {
+    if (usr == "" || psw == "") return _AUTH_DENIED;
+
+    std::string msg = "register: " + usr;
+    Logger::Instance()->LOG_DEBUG(msg);
+
+    return AuthStore::Instance()->add(usr, psw);
+}
@@ -0,0 +1,27 @@
+/*
+    登录与注册的处理函数，注册于路由表
+    表单字段: isLogin(1 为登录) username password
+*/
+
+#ifndef _ACCOUNT_HANDLER_H
+#define _ACCOUNT_HANDLER_H
+
+#include <string>
+
+#include "../auth/authStore.h"
+#include "../logger/logger.h"
+#include "httpRequest.h"
+
+class AccountHandler {
+public:
+    /**
+     * @brief 处理登录或注册表单，成功响应欢迎页，失败响应错误页，账户存储不可用时响应503
+     */
+    static int handle(const HttpRequest& request, std::string& page);
+
+private:
+    static AUTH_RESULT userLogin(const std::string& user, const std::string& psw);
+    static AUTH_RESULT userRegister(const std::string& user, const std::string& psw);
+};
+
+#endif  // _ACCOUNT_HANDLER_H
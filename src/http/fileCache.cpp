@@ -0,0 +1,562 @@
+#include "fileCache.h"
+
+FileCache FileCache::s_fileCache;
+
+CachedFile::CachedFile(const std::string& path, const struct stat& fileState)
+    :m_path(path), m_fileState(fileState), m_data(nullptr), m_fd(-1) {}
+
+CachedFile::~CachedFile() {
+    delete[] m_data;
+
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+/**
+ * @brief 载入文件内容
+ *
+ * @param fd     已打开的文件
+ * @param keepFd true - 接管fd，内容由sendfile发送; false - 读入堆内存，之后与文件本身无关
+ * @return true  成功
+ * @return false 失败
+ */
+bool CachedFile::load(int fd, bool keepFd) {
+    if (keepFd) {
+        m_fd = fd;
+        makeValidators("");
+        return true;
+    }
+
+    if (m_fileState.st_size == 0) {
+        makeValidators("");
+        return true;
+    }
+
+    m_data = new char[m_fileState.st_size];
+
+    off_t offset = 0;
+    while (offset < m_fileState.st_size) {
+        ssize_t len = pread(fd, m_data + offset, m_fileState.st_size - offset, offset);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;  // 读取期间文件被截断
+
+        offset += len;
+    }
+
+    m_fileState.st_size = offset;
+    makeValidators("");
+
+    return true;
+}
+
+/**
+ * @brief 由inode、大小与修改时间生成强ETag，以及Last-Modified
+ *
+ * @param suffix 区分同一文件的不同编码(如gzip副本)
+ */
+void CachedFile::makeValidators(const char* suffix) {
+    char buf[96];
+
+    snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx%s\"",
+        static_cast<unsigned long>(m_fileState.st_ino), static_cast<unsigned long>(m_fileState.st_size),
+        static_cast<unsigned long>(m_fileState.st_mtim.tv_sec * 1000000000L + m_fileState.st_mtim.tv_nsec), suffix);
+    m_etag = buf;
+
+    struct tm gmt;
+    gmtime_r(&m_fileState.st_mtim.tv_sec, &gmt);
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+    m_lastModified = buf;
+}
+
+/**
+ * @brief 获取gzip副本，多线程并发请求时只压缩一次
+ *
+ * @param created 带出副本是否由本次调用生成
+ * @return std::shared_ptr<const CachedFile> 大文件、过小或压缩无收益时返回nullptr
+ */
+std::shared_ptr<const CachedFile> CachedFile::gzipped(bool* created) const {
+    std::call_once(m_gzipOnce, [this, created] {
+        if (!m_data || size() < GZIP_MIN_SIZE)
+            return;
+
+        auto gz = std::make_shared<CachedFile>(m_path, m_fileState);
+        if (gz->compress(*this)) {
+            m_gzipped = gz;
+
+            if (created)
+                *created = true;
+        }
+    });
+
+    return m_gzipped;
+}
+
+/**
+ * @brief 将src内容压缩为gzip格式存入本对象
+ *
+ * @return true  压缩后至少缩小1/8
+ * @return false 失败或无收益
+ */
+bool CachedFile::compress(const CachedFile& src) {
+    z_stream stream = { 0 };
+
+    // windowBits + 16 输出gzip头
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    uLong bound = deflateBound(&stream, src.size());
+    m_data = new char[bound];
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src.data()));
+    stream.avail_in = src.size();
+    stream.next_out = reinterpret_cast<Bytef*>(m_data);
+    stream.avail_out = bound;
+
+    int ret = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+
+    // 校验器沿用原文件的版本信息
+    m_fileState.st_size = src.size();
+    makeValidators("-gz");
+    m_fileState.st_size = stream.total_out;
+
+    return ret == Z_STREAM_END && size() < src.size() - src.size() / 8;
+}
+
+int CachedFile::fd() const {
+    return m_fd;
+}
+
+const char* CachedFile::data() const {
+    return m_data;
+}
+
+size_t CachedFile::size() const {
+    return m_fileState.st_size;
+}
+
+const std::string& CachedFile::path() const {
+    return m_path;
+}
+
+const struct stat& CachedFile::fileState() const {
+    return m_fileState;
+}
+
+const std::string& CachedFile::etag() const {
+    return m_etag;
+}
+
+const std::string& CachedFile::lastModified() const {
+    return m_lastModified;
+}
+
+
+FileCache::FileCache()
+    :m_capacity(FILE_CACHE_CAPACITY), m_maxEntrySize(FILE_CACHE_MAX_ENTRY), m_usedBytes(0), m_openFds(0), m_generation(0),
+     m_inotifyFd(-1), m_stopFd(-1), m_watching(false) {}
+
+FileCache::~FileCache() {
+    destroy();
+}
+
+FileCache* FileCache::Instance() {
+    return &s_fileCache;
+}
+
+/**
+ * @brief 文件缓存初始化，并监听资源目录的变更
+ *
+ * @param rootDir      资源根目录
+ * @param capacity     缓存总大小上限
+ * @param maxEntrySize 可缓存的单个文件大小上限
+ */
+void FileCache::init(const std::string& rootDir, size_t capacity, size_t maxEntrySize) {
+    m_capacity = capacity;
+    m_maxEntrySize = maxEntrySize;
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_inotifyFd < 0 || m_stopFd < 0) {
+        Logger::Instance()->LOG_WARNING("inotify unavailable, file cache falls back to mtime checks");
+        return;
+    }
+
+    watchDir(rootDir);
+
+    m_watching = true;
+    m_watchThread = std::make_unique<std::thread>(&FileCache::watchThreadJobs, this);
+}
+
+/**
+ * @brief 获取资源文件，启用inotify时命中不产生系统调用
+ *
+ * @param path 资源绝对路径
+ * @param err  失败时带出errno (ENOENT/EISDIR - 不存在, EACCES - 无权限)
+ * @return std::shared_ptr<const CachedFile> 失败返回nullptr
+ */
+std::shared_ptr<const CachedFile> FileCache::acquire(const std::string& path, int* err) {
+    uint64_t generation = 0;
+    std::shared_ptr<const CachedFile> cached;
+
+    {
+        std::lock_guard<std::mutex> guard(m_mtx);
+        generation = m_generation;
+
+        auto it = m_entries.find(path);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+
+            if (m_watching)
+                return it->second.file;
+
+            cached = it->second.file;
+        }
+    }
+
+    // 未启用inotify时在锁外比对mtime，命中不因他人的stat而排队
+    if (cached) {
+        if (!isStale(*cached))
+            return cached;
+
+        std::lock_guard<std::mutex> guard(m_mtx);
+
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->second.file == cached)
+            erase(it);  // 其他线程可能已换上新载入的版本
+    }
+
+    std::shared_ptr<const CachedFile> file = loadFile(path, err);
+
+    // 含 "//" "/." 的路径与监听到的路径对不上，不入缓存以免无法失效
+    if (file && path.find("//") == std::string::npos && path.find("/.") == std::string::npos)
+        insert(file, generation);
+
+    return file;
+}
+
+/**
+ * @brief 获取缓存项的gzip副本，新生成的副本计入缓存大小，超出上限时淘汰
+ *
+ * @param file 由 acquire 取得的文件
+ * @return std::shared_ptr<const CachedFile> 无可用副本时返回nullptr
+ */
+std::shared_ptr<const CachedFile> FileCache::gzipped(const std::shared_ptr<const CachedFile>& file) {
+    bool created = false;
+    std::shared_ptr<const CachedFile> gz = file->gzipped(&created);
+
+    if (!created)
+        return gz;
+
+    std::lock_guard<std::mutex> guard(m_mtx);
+
+    // 原文件已不在缓存中(失效、淘汰或未入缓存)时副本随持有者释放，不计入
+    auto it = m_entries.find(file->path());
+    if (it != m_entries.end() && it->second.file == file) {
+        it->second.gzipBytes = gz->size();
+        m_usedBytes += gz->size();
+        evict();
+    }
+
+    return gz;
+}
+
+/**
+ * @brief 使缓存项失效，已持有该项的连接不受影响；正在载入的文件不会再入缓存
+ *
+ * @param path 资源绝对路径
+ */
+void FileCache::invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> guard(m_mtx);
+    m_generation++;
+
+    auto it = m_entries.find(path);
+    if (it == m_entries.end())
+        return;
+
+    erase(it);
+
+    std::string msg = "file cache invalidated: " + path;
+    Logger::Instance()->LOG_DEBUG(msg);
+}
+
+/**
+ * @brief 目录被移走、删除或移入时，其下的缓存项全部失效
+ *
+ * @param dir 目录绝对路径
+ */
+void FileCache::invalidateDir(const std::string& dir) {
+    const std::string prefix = dir + '/';
+
+    std::lock_guard<std::mutex> guard(m_mtx);
+    m_generation++;
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0)
+            erase(it++);
+        else
+            ++it;
+    }
+
+    std::string msg = "file cache invalidated: " + prefix;
+    Logger::Instance()->LOG_DEBUG(msg);
+}
+
+/**
+ * @brief 停止监听并清空缓存
+ */
+void FileCache::destroy() {
+    if (m_watchThread) {
+        uint64_t one = 1;
+        if (::write(m_stopFd, &one, sizeof(one)) == sizeof(one))
+            m_watchThread->join();
+        else
+            m_watchThread->detach();
+
+        m_watchThread.reset();
+    }
+
+    if (m_inotifyFd >= 0)
+        close(m_inotifyFd);
+    if (m_stopFd >= 0)
+        close(m_stopFd);
+
+    m_inotifyFd = m_stopFd = -1;
+    m_watching = false;
+
+    std::lock_guard<std::mutex> guard(m_mtx);
+    m_entries.clear();
+    m_lru.clear();
+    m_usedBytes = m_openFds = 0;
+}
+
+size_t FileCache::usedBytes() {
+    std::lock_guard<std::mutex> guard(m_mtx);
+
+    return m_usedBytes;
+}
+
+/**
+ * @brief 从磁盘载入文件，大文件只保留fd
+ */
+std::shared_ptr<const CachedFile> FileCache::loadFile(const std::string& path, int* err) {
+    struct stat fileState = { 0 };
+
+    if (stat(path.data(), &fileState) < 0) {
+        *err = errno;
+        return nullptr;
+    }
+
+    if (S_ISDIR(fileState.st_mode)) {
+        *err = EISDIR;
+        return nullptr;
+    }
+
+    if (!(fileState.st_mode & S_IROTH)) {
+        *err = EACCES;
+        return nullptr;
+    }
+
+    int fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *err = errno;
+        return nullptr;
+    }
+
+    auto file = std::make_shared<CachedFile>(path, fileState);
+    bool keepFd = static_cast<size_t>(fileState.st_size) > m_maxEntrySize;
+    bool loaded = file->load(fd, keepFd);
+
+    if (!keepFd)
+        close(fd);
+
+    if (!loaded) {
+        *err = EIO;
+        return nullptr;
+    }
+
+    std::string msg = "load file path: " + path;
+    Logger::Instance()->LOG_DEBUG(msg);
+
+    return file;
+}
+
+/**
+ * @brief 未启用inotify时，比对文件当前的mtime与大小
+ */
+bool FileCache::isStale(const CachedFile& file) const {
+    struct stat fileState = { 0 };
+
+    if (stat(file.path().data(), &fileState) < 0)
+        return true;
+
+    return fileState.st_mtim.tv_sec != file.fileState().st_mtim.tv_sec
+        || fileState.st_mtim.tv_nsec != file.fileState().st_mtim.tv_nsec
+        || fileState.st_size != file.fileState().st_size;
+}
+
+/**
+ * @brief 载入的文件加入缓存
+ *
+ * @param generation 开始载入前的失效计数，其后发生过失效时载入的可能是旧内容，不入缓存
+ */
+void FileCache::insert(const std::shared_ptr<const CachedFile>& file, uint64_t generation) {
+    std::lock_guard<std::mutex> guard(m_mtx);
+
+    if (generation != m_generation)
+        return;
+
+    auto it = m_entries.find(file->path());
+    if (it != m_entries.end())
+        erase(it);  // 其他线程已先行载入
+
+    m_lru.push_front(file->path());
+    m_entries[file->path()] = { file, m_lru.begin(), 0 };
+
+    if (file->fd() >= 0)
+        m_openFds++;
+    else
+        m_usedBytes += file->size();
+
+    evict();
+}
+
+// 调用方已持锁
+void FileCache::evict() {
+    while ((m_usedBytes > m_capacity || m_openFds > FILE_CACHE_MAX_FDS) && !m_lru.empty())
+        erase(m_entries.find(m_lru.back()));
+}
+
+// 调用方已持锁
+void FileCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    if (it->second.file->fd() >= 0)
+        m_openFds--;
+    else
+        m_usedBytes -= it->second.file->size() + it->second.gzipBytes;
+
+    m_lru.erase(it->second.lruPos);
+    m_entries.erase(it);
+}
+
+/**
+ * @brief 递归监听目录
+ *
+ * @param dir
+ */
+void FileCache::watchDir(const std::string& dir) {
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    int wd = inotify_add_watch(m_inotifyFd, dir.data(), mask);
+    if (wd < 0) {
+        std::string msg = "inotify watch error: " + dir;
+        Logger::Instance()->LOG_WARNING(msg);
+        return;
+    }
+
+    m_watchDirs[wd] = dir;
+
+    DIR* dp = opendir(dir.data());
+    if (!dp)
+        return;
+
+    while (struct dirent* ent = readdir(dp)) {
+        if (ent->d_type == DT_DIR && strcmp(ent->d_name, ".") && strcmp(ent->d_name, ".."))
+            watchDir(dir + '/' + ent->d_name);
+    }
+
+    closedir(dp);
+}
+
+/**
+ * @brief 移除目录及其子目录上的监听，其路径已不再指向这些目录
+ *
+ * @param dir
+ */
+void FileCache::unwatchDir(const std::string& dir) {
+    const std::string prefix = dir + '/';
+
+    for (auto it = m_watchDirs.begin(); it != m_watchDirs.end(); ) {
+        if (it->second == dir || it->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(m_inotifyFd, it->first);
+            it = m_watchDirs.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+/**
+ * @brief 监听线程，将文件变更转为缓存失效
+ *        目录移走、删除后按原路径移除监听，移入时按新路径重新监听
+ */
+void FileCache::watchThreadJobs() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = { { m_inotifyFd, POLLIN, 0 }, { m_stopFd, POLLIN, 0 } };
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        ssize_t len = 0;
+        while ((len = ::read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+            for (char* ptr = buf; ptr < buf + len; ) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                // 事件队列溢出，无法得知具体变更
+                if (event->mask & IN_Q_OVERFLOW) {
+                    std::lock_guard<std::mutex> guard(m_mtx);
+                    m_generation++;
+                    m_entries.clear();
+                    m_lru.clear();
+                    m_usedBytes = m_openFds = 0;
+                    continue;
+                }
+
+                auto it = m_watchDirs.find(event->wd);
+                if (it == m_watchDirs.end())
+                    continue;
+
+                if (event->mask & IN_IGNORED) {
+                    m_watchDirs.erase(it);
+                    continue;
+                }
+
+                // 被监听的目录自身被移走或删除(如资源根目录)，原路径已失效
+                if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) {
+                    const std::string dir = it->second;     // unwatchDir 会移除 it
+                    invalidateDir(dir);
+                    unwatchDir(dir);
+                    continue;
+                }
+
+                if (!event->len)
+                    continue;
+
+                std::string path = it->second + '/' + event->name;
+
+                if (!(event->mask & IN_ISDIR)) {
+                    invalidate(path);
+                    continue;
+                }
+
+                if (event->mask & (IN_MOVED_FROM | IN_DELETE | IN_MOVED_TO))
+                    invalidateDir(path);
+
+                if (event->mask & (IN_MOVED_FROM | IN_DELETE))
+                    unwatchDir(path);
+                else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    watchDir(path);
+            }
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/*
+    静态资源文件缓存
+    以资源绝对路径为键，内容常驻内存并按引用计数在连接间共享，LRU淘汰控制总大小，inotify监听变更失效
+    大文件只缓存打开的fd，由sendfile直接从页缓存发送
+    可压缩的文本资源在首次被支持gzip的客户端请求时生成gzip副本，计入缓存大小，随原缓存项一同失效
+*/
+
+#ifndef _FILE_CACHE_H
+#define _FILE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <zlib.h>
+
+#include "../logger/logger.h"
+
+#define FILE_CACHE_CAPACITY     (64 << 20)  // 缓存总大小上限
+#define FILE_CACHE_MAX_ENTRY    (1 << 20)   // 单个文件超过该大小时不读入内存，只缓存fd走sendfile
+#define FILE_CACHE_MAX_FDS      256         // 缓存中持有的大文件fd数量上限
+#define GZIP_MIN_SIZE           256         // 小于该大小的文件不压缩
+
+/**
+ * @brief 一个已载入的资源文件，最后一个持有者释放时回收内存
+ */
+class CachedFile {
+public:
+    CachedFile(const std::string& path, const struct stat& fileState);
+    ~CachedFile();
+
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+
+public:
+    bool load(int fd, bool keepFd);
+    std::shared_ptr<const CachedFile> gzipped(bool* created = nullptr) const;
+
+    int fd() const;
+    const char* data() const;
+    size_t size() const;
+    const std::string& path() const;
+    const struct stat& fileState() const;
+    const std::string& etag() const;
+    const std::string& lastModified() const;
+
+private:
+    std::string m_path;
+    struct stat m_fileState;
+
+    char* m_data;   // 堆内存副本
+    int m_fd;       // 大文件不读入内存，持有fd供sendfile使用
+
+    // 校验器，每个文件版本(缓存项)只生成一次
+    std::string m_etag;
+    std::string m_lastModified;
+
+    // gzip副本，首次使用时生成；压缩无收益时为空
+    mutable std::once_flag m_gzipOnce;
+    mutable std::shared_ptr<const CachedFile> m_gzipped;
+
+    bool compress(const CachedFile& src);
+    void makeValidators(const char* suffix);
+};
+
+class FileCache {
+public:
+    FileCache();
+    ~FileCache();
+
+    static FileCache* Instance();
+
+public:
+    void init(const std::string& rootDir, size_t capacity = FILE_CACHE_CAPACITY, size_t maxEntrySize = FILE_CACHE_MAX_ENTRY);
+    std::shared_ptr<const CachedFile> acquire(const std::string& path, int* err);
+    std::shared_ptr<const CachedFile> gzipped(const std::shared_ptr<const CachedFile>& file);
+    void invalidate(const std::string& path);
+    void destroy();
+
+    size_t usedBytes();
+
+private:
+    struct Entry {
+        std::shared_ptr<const CachedFile> file;
+        std::list<std::string>::iterator lruPos;
+        size_t gzipBytes;   // 已计入的gzip副本大小
+    };
+
+    std::mutex m_mtx;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string> m_lru;   // 头部为最近使用
+    size_t m_capacity;
+    size_t m_maxEntrySize;
+    size_t m_usedBytes;     // 内存副本总大小，含gzip副本
+    size_t m_openFds;       // fd项数量
+    uint64_t m_generation;  // 每次失效加一，载入期间发生过失效的文件不入缓存
+
+    // inotify 监听，不可用时退回逐次比对mtime
+    int m_inotifyFd;
+    int m_stopFd;
+    bool m_watching;
+    std::unordered_map<int, std::string> m_watchDirs;   // wd -> 目录
+    std::unique_ptr<std::thread> m_watchThread;
+
+    static FileCache s_fileCache;
+
+private:
+    std::shared_ptr<const CachedFile> loadFile(const std::string& path, int* err);
+    bool isStale(const CachedFile& file) const;
+    void insert(const std::shared_ptr<const CachedFile>& file, uint64_t generation);
+    void evict();
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+    void invalidateDir(const std::string& dir);
+
+    void watchDir(const std::string& dir);
+    void unwatchDir(const std::string& dir);
+    void watchThreadJobs();
+};
+
+#endif  // _FILE_CACHE_H
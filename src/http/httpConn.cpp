@@ -3,11 +3,19 @@
 bool HttpConn::s_useET;
 std::string HttpConn::s_srcDir;
 std::atomic<size_t> HttpConn::s_usersCount(0);
+thread_local char HttpConn::s_expandedBuff[EXPANDED_BUFF_SIZE];
 
 HttpConn::HttpConn() {
     m_fd = -1;
     m_addr = { 0 };
     m_isClosed = true;
+    m_isKeepAlive = false;
+    m_deferState = _NOT_DEFERRED;
+
+    m_iovWriteIdx = 0;
+    m_bytesToSend = 0;
+    m_sliceIdx = 0;
+    m_sendFileBytes = 0;
 }
 
 HttpConn::~HttpConn() {
@@ -20,8 +28,11 @@ void HttpConn::init(int connFd, const sockaddr_in &addr) {
     m_fd = connFd;
     m_addr = addr;
 
-    m_writeBuff.retrieveAll();
+    releaseResponses();
     m_readBuff.retrieveAll();
+    m_request.init();
+    m_isKeepAlive = false;
+    m_deferState = _NOT_DEFERRED;
 
     s_usersCount += 1;
     m_isClosed = false;
@@ -44,20 +55,20 @@ ssize_t HttpConn::read(int* readErrno) {
 
         m_iovRead[0].iov_base = m_readBuff.beginWritePtr();
         m_iovRead[0].iov_len = writable;
-        m_iovRead[1].iov_base = m_expandedBuff;
+        m_iovRead[1].iov_base = s_expandedBuff;
         m_iovRead[1].iov_len = EXPANDED_BUFF_SIZE;
 
-        const ssize_t len = readv(m_fd, m_iovRead, 2);
+        len = readv(m_fd, m_iovRead, 2);
         if (len < 0) {
             *readErrno = errno;
             break;
         }
-        else if (len <= writable)
+        else if (static_cast<size_t>(len) <= writable)
             m_readBuff.hasWritten(len);
         else {
             // 大于buffer长度，扩容存储
             m_readBuff.beenFilled();
-            m_readBuff.append(m_expandedBuff, len - writable);
+            m_readBuff.append(s_expandedBuff, len - writable);
         }
 
         if (len == 0)
@@ -78,76 +89,304 @@ ssize_t HttpConn::write(int* readErrno) {
     ssize_t len = -1;
 
     do {
-        len = writev(m_fd, m_iovWrite, m_iovWriteCnt);
+        if (m_bytesToSend == 0)     // 所有数据被传输关闭
+            break;
+
+        int iovCnt = 0;
+        const struct iovec* iov = writeIov(&iovCnt);
+
+        if (iovCnt == 0) {
+            len = sendFile(readErrno);  // 下一段为经sendfile发送的文件片段
+            if (len < 0)
+                break;
+            continue;
+        }
+
+        struct msghdr msg = { 0 };
+        msg.msg_iov = const_cast<struct iovec*>(iov);
+        msg.msg_iovlen = std::min(iovCnt, IOV_MAX);
+
+        // 其后还有sendfile片段时，不满一个报文的响应头与文件体合并发出
+        len = sendmsg(m_fd, &msg, MSG_NOSIGNAL | (m_sendFileBytes ? MSG_MORE : 0));
 
         if (len < 0) {
             *readErrno = errno;
             break;
         } 
-        else if (m_iovWrite[0].iov_len + m_iovWrite[1].iov_len == 0)    // 所有数据被传输关闭
-            break;
-        else if (static_cast<size_t>(len) > m_iovWrite[0].iov_len) {    // 保证都是无符号比较
-            // 本轮写出数据大于iovWrite的第一个向量
-            m_iovWrite[1].iov_base = static_cast<char*>(m_iovWrite[1].iov_base) + (len - m_iovWrite[0].iov_len);
-            m_iovWrite[1].iov_len -= len - m_iovWrite[0].iov_len;
-
-            if (m_iovWrite[0].iov_len) 
-                m_iovWrite[0].iov_len = 0;
-        } else {
-            m_iovWrite[0].iov_base = static_cast<char*>(m_iovWrite[0].iov_base) + len;
-            m_iovWrite[0].iov_len -= len;
-        }
+
+        hasWritten(len);
         
     } while(s_useET || bytesToSend() > CONTINUE_SEND_BYTES);    // ET模式 或者 待传输数据量大于阈值
 
     return len;
 }
 
+/**
+ * @brief 以sendfile发送当前的大文件片段，数据由页缓存直接进入socket
+ * 
+ * @param sendErrno 带出错误
+ * @return ssize_t  本次发送长度
+ */
+ssize_t HttpConn::sendFile(int* sendErrno) {
+    assert(m_sliceIdx < m_fileSlices.size() && m_fileSlices[m_sliceIdx].iovIdx == m_iovWriteIdx);
+
+    FileSlice& slice = m_fileSlices[m_sliceIdx];
+    ssize_t len = sendfile(m_fd, slice.file->fd(), &slice.offset, slice.len);
+
+    if (len < 0) {
+        *sendErrno = errno;
+        return -1;
+    }
+
+    if (len == 0) {     // 文件在发送期间被截断
+        *sendErrno = EIO;
+        return -1;
+    }
+
+    slice.len -= len;
+    if (slice.len == 0)
+        m_sliceIdx++;
+
+    m_sendFileBytes -= len;
+    m_bytesToSend -= len;
+
+    return len;
+}
+
+/**
+ * @brief 待经sendfile发送的文件体长度
+ */
+size_t HttpConn::pendingFileBytes() const {
+    return m_sendFileBytes;
+}
+
+/**
+ * @brief 追加读入数据
+ * 
+ * @param data 
+ * @param len 
+ */
+void HttpConn::appendRead(const char* data, size_t len) {
+    m_readBuff.append(data, len);
+}
+
+/**
+ * @brief 待写出向量
+ * 
+ * @param iovCnt 带出向量个数
+ * @return const struct iovec* 
+ */
+const struct iovec* HttpConn::writeIov(int* iovCnt) const {
+    // 只给出下一个sendfile片段之前的向量
+    size_t limit = m_sliceIdx < m_fileSlices.size() ? m_fileSlices[m_sliceIdx].iovIdx : m_iovWrite.size();
+    *iovCnt = limit - m_iovWriteIdx;
+
+    return m_iovWrite.data() + m_iovWriteIdx;
+}
+
+/**
+ * @brief 按已写出长度推进写出向量
+ * 
+ * @param len 已写出长度
+ */
+void HttpConn::hasWritten(size_t len) {
+    assert(len <= m_bytesToSend);
+    m_bytesToSend -= len;
+
+    // 跳过已完整写出的向量，截断写出一半的向量
+    while (len && m_iovWriteIdx < m_iovWrite.size()) {
+        struct iovec& iov = m_iovWrite[m_iovWriteIdx];
+
+        if (len < iov.iov_len) {
+            iov.iov_base = static_cast<char*>(iov.iov_base) + len;
+            iov.iov_len -= len;
+            break;
+        }
+
+        len -= iov.iov_len;
+        iov.iov_len = 0;
+        m_iovWriteIdx++;
+    }
+}
+
 /**
  * @brief 进一步处理(解析请求、组装响应、准备写出向量)
+ *
+ * 读缓冲区中所有完整的流水线请求依次处理，响应按序排入同一组写出向量，由一次writev写出
+ * 末尾不完整的请求保留解析进度，下次读入后继续
+ * 路由到阻塞处理函数的请求在此停下，由外部执行 runDeferred 后再次调用时从它继续
  * 
- * @return true  1
- * @return false 0
+ * @return true  有响应待写出
+ * @return false 需要更多数据，连接回到读事件
  */
 bool HttpConn::process() {
-    m_request.init();
+    releaseResponses();     // 上一批响应已写出
+
+    // 各响应在writeBuff中的响应头区间及其响应体片段，writeBuff扩容后地址会变，最后统一生成向量
+    struct Segment {
+        size_t headBegin;
+        size_t headEnd;
+        std::shared_ptr<const CachedFile> file;
+        std::vector<HttpResponse::BodyPart> parts;
+    };
+    std::vector<Segment> segments;
+
+    while (segments.size() < MAX_PIPELINED_REQUESTS && m_deferState != _DEFERRED
+           && (m_deferState == _RESUMED || m_readBuff.readableBytes())) {
+        bool parsed = true;
+
+        if (m_deferState == _RESUMED)
+            m_deferState = _NOT_DEFERRED;   // 处理函数已执行，m_request 仍为该请求
+        else {
+            parsed = m_request.parse(m_readBuff);
+
+            // 请求不完整: 解析状态保留在m_request中，读入更多数据后继续
+            if (!parsed && m_request.error() == HttpRequest::_NO_ERROR)
+                break;
+
+            if (parsed) {
+                Router::Instance()->dispatch(m_request, m_target);
+
+                if (m_target.deferred) {
+                    m_deferState = _DEFERRED;
+                    break;
+                }
+            }
+        }
+
+        if (parsed) {
+            m_response.init(m_target.dir, m_target.path, m_request.isKeepAlive(), m_target.code, m_request.acceptsGzip());
+            m_response.setConditional(m_request.header(HttpRequest::_IF_NONE_MATCH), m_request.header(HttpRequest::_IF_MODIFIED_SINCE));
+            m_response.setRange(m_request.header(HttpRequest::_RANGE), m_request.header(HttpRequest::_IF_RANGE));
+        }
+        else {
+            m_response.init(s_srcDir, m_request.path(), false, m_request.errorStatus());
+            m_readBuff.retrieveAll();   // 无法定位下一个请求的起点
+        }
+
+        Segment seg = { m_writeBuff.readableBytes(), 0, nullptr, {} };
+        m_response.makeResponse(m_writeBuff);   // http响应字符拼接完成 以及 对应资源的获取
+
+        seg.headEnd = m_writeBuff.readableBytes();
+        seg.file = m_response.file();
+        seg.parts = m_response.bodyParts();
+        m_response.releaseFile();
+
+        // 响应头止于第一个位于写缓冲区的响应体片段(multipart分隔头)
+        for (const HttpResponse::BodyPart& part : seg.parts) {
+            if (part.inBuff) {
+                seg.headEnd = part.offset;
+                break;
+            }
+        }
+
+        // HEAD 与 GET 的响应头相同，只发到空行为止(内置错误页的响应体同在写缓冲区)
+        if (parsed && m_request.method() == "HEAD") {
+            std::string_view head(m_writeBuff.peek() + seg.headBegin, seg.headEnd - seg.headBegin);
+            seg.headEnd = seg.headBegin + head.find(CRLF CRLF) + 4;
+            seg.file.reset();
+            seg.parts.clear();
+        }
+
+        segments.push_back(std::move(seg));
+        m_isKeepAlive = m_request.isKeepAlive();
+
+        if (!m_isKeepAlive)
+            break;  // 连接将在本批写出后关闭，其后的请求不再处理
+    }
 
-    if (m_readBuff.readableBytes() < 0)
+    if (segments.empty())
         return false;
-    else if (m_request.parse(m_readBuff))
-        m_response.init(s_srcDir, m_request.path(), m_request.isKeepAlive(), 200);
-    else
-        m_response.init(s_srcDir, m_request.path(), false, 400);
-
-    m_response.makeResponse(m_writeBuff);   // http响应字符拼接完成 以及 对应资源的内存映射
-    
-    m_iovWrite[0].iov_base = const_cast<char*>(m_writeBuff.peek());
-    m_iovWrite[0].iov_len = m_writeBuff.readableBytes();
-    m_iovWriteCnt = 1;
-
-    if (m_response.mmFile() && m_response.mmFileSize()) {
-        m_iovWrite[1].iov_base = m_response.mmFile();
-        m_iovWrite[1].iov_len = m_response.mmFileSize();
-        m_iovWriteCnt = 2;
+
+    char* base = const_cast<char*>(m_writeBuff.peek());
+
+    // 相邻且连续的片段合并为一个向量，但不跨越sendfile片段
+    auto pushIov = [this](char* ptr, size_t len) {
+        if (len == 0)
+            return;
+
+        bool atSlice = !m_fileSlices.empty() && m_fileSlices.back().iovIdx == m_iovWrite.size();
+        if (!m_iovWrite.empty() && !atSlice && static_cast<char*>(m_iovWrite.back().iov_base) + m_iovWrite.back().iov_len == ptr)
+            m_iovWrite.back().iov_len += len;
+        else
+            m_iovWrite.push_back({ ptr, len });
+
+        m_bytesToSend += len;
+    };
+
+    for (Segment& seg : segments) {
+        pushIov(base + seg.headBegin, seg.headEnd - seg.headBegin);
+
+        for (const HttpResponse::BodyPart& part : seg.parts) {
+            if (part.inBuff)
+                pushIov(base + part.offset, part.len);
+            else if (seg.file->fd() >= 0 && part.len) {
+                // 大文件片段经sendfile发出
+                m_fileSlices.push_back({ m_iovWrite.size(), seg.file, static_cast<off_t>(part.offset), part.len });
+                m_sendFileBytes += part.len;
+                m_bytesToSend += part.len;
+            }
+            else
+                pushIov(const_cast<char*>(seg.file->data()) + part.offset, part.len);
+        }
+
+        if (seg.file)
+            m_files.push_back(std::move(seg.file));
     }
 
     return true;
 }
 
+/**
+ * @brief 释放上一批响应(响应头与文件引用)
+ */
+void HttpConn::releaseResponses() {
+    m_files.clear();
+    m_fileSlices.clear();
+    m_sliceIdx = 0;
+    m_sendFileBytes = 0;
+
+    m_iovWrite.clear();
+    m_iovWriteIdx = 0;
+    m_bytesToSend = 0;
+
+    m_writeBuff.retrieveAll();
+}
+
+/**
+ * @brief 是否有待执行的阻塞处理函数
+ */
+bool HttpConn::isDeferred() const {
+    return m_deferState == _DEFERRED;
+}
+
+/**
+ * @brief 执行阻塞处理函数，在数据库线程中调用；请求各字段指向读缓冲区，期间连接不得读入数据
+ */
+void HttpConn::runDeferred() {
+    assert(m_deferState == _DEFERRED);
+
+    Router::Instance()->runDeferred(m_request, m_target);
+    m_deferState = _RESUMED;
+}
+
 /**
  * @brief 连接关闭
  * 
+ * @param fdReleased fd是否已由外部关闭(io_uring close)
  * @return true  1
  * @return false 0
  */
-bool HttpConn::doClose() {
-    m_response.unmapFile();
+bool HttpConn::doClose(bool fdReleased) {
+    m_response.releaseFile();
+    releaseResponses();
 
     if (!m_isClosed) {
-        m_writeBuff.retrieveAll();
         m_readBuff.retrieveAll();
+        m_deferState = _NOT_DEFERRED;
 
-        close(m_fd);
+        if (!fdReleased)
+            close(m_fd);
         m_isClosed = true;
 
         if (s_usersCount)
@@ -163,6 +402,10 @@ bool HttpConn::doClose() {
 }
 
 
+bool HttpConn::isClosed() const {
+    return m_isClosed;
+}
+
 int HttpConn::getFd() const {
     return m_fd;
 }
@@ -180,10 +423,11 @@ int HttpConn::getPort() const {
 }
 
 // 待传输数据长度
-const int HttpConn::bytesToSend() const {
-    return m_iovWrite[0].iov_len + m_iovWrite[1].iov_len;
+size_t HttpConn::bytesToSend() const {
+    return m_bytesToSend;
 }
 
+// 本批最后一个请求是否保持连接，解析器此时可能已在解析下一个请求
 const bool HttpConn::isKeepAlive() const {
-    return m_request.isKeepAlive();
+    return m_isKeepAlive;
 }
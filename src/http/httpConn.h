@@ -4,14 +4,21 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sys/uio.h>    // readv writev
+#include <sys/socket.h> // sendmsg
+#include <sys/sendfile.h>
 #include <errno.h>
+#include <limits.h>     // IOV_MAX
+#include <vector>
+#include <algorithm>
 
 #include "../buffer/buffer.h"
 #include "httpRequest.h"
 #include "httpResponse.h"
+#include "router.h"
 
 #define EXPANDED_BUFF_SIZE  65535
 #define CONTINUE_SEND_BYTES 10240
+#define MAX_PIPELINED_REQUESTS  32  // 单次处理的流水线请求上限，其余待本批写出后继续
 
 class HttpConn {
 public:
@@ -22,6 +29,13 @@ public:
     void init(int connFd, const sockaddr_in& addr);
     ssize_t read(int* readErrno);
     ssize_t write(int* writeErrno);
+
+    // 由外部完成io时使用(io_uring)
+    void appendRead(const char* data, size_t len);
+    const struct iovec* writeIov(int* iovCnt) const;
+    void hasWritten(size_t len);
+    ssize_t sendFile(int* sendErrno);
+    size_t pendingFileBytes() const;
     
     static bool s_useET;
     static std::string s_srcDir;
@@ -35,27 +49,56 @@ public:
     int getPort() const;
 
     bool process();
-    bool doClose();
+    bool doClose(bool fdReleased = false);
+    bool isClosed() const;
+
+    // 阻塞的处理函数(数据库)由外部交给专用线程执行，期间连接不得读入数据
+    bool isDeferred() const;
+    void runDeferred();
 
-    const int bytesToSend() const;
+    size_t bytesToSend() const;
     const bool isKeepAlive() const;
     
 private:
     int m_fd;
     struct sockaddr_in m_addr;
     bool m_isClosed;
+    bool m_isKeepAlive;
 
     Buffer m_readBuff;
     Buffer m_writeBuff;
 
-    char m_expandedBuff[EXPANDED_BUFF_SIZE];
+    static thread_local char s_expandedBuff[EXPANDED_BUFF_SIZE];   // 读溢出暂存区，线程间独立、连接间共享
 
     struct iovec m_iovRead[2];
-    struct iovec m_iovWrite[2];
-    short m_iovWriteCnt;
+    std::vector<struct iovec> m_iovWrite;   // 按序排列的各响应: 响应头(writeBuff) + 资源文件内容
+    size_t m_iovWriteIdx;                   // 首个未写完的向量
+    size_t m_bytesToSend;
+    std::vector<std::shared_ptr<const CachedFile>> m_files;    // 本批响应引用的资源文件，写完后释放
+
+    // 经sendfile发送的大文件片段，在第iovIdx个向量之前发出
+    struct FileSlice {
+        size_t iovIdx;
+        std::shared_ptr<const CachedFile> file;
+        off_t offset;
+        size_t len;
+    };
+    std::vector<FileSlice> m_fileSlices;
+    size_t m_sliceIdx;      // 首个未发完的片段
+    size_t m_sendFileBytes;
+
+    void releaseResponses();
 
     HttpRequest m_request;
     HttpResponse m_response;
+    Router::Target m_target;
+
+    enum DEFER_STATE {
+        _NOT_DEFERRED,
+        _DEFERRED,      // 当前请求的处理函数待执行，其后的请求暂不处理
+        _RESUMED        // 处理函数已执行，待组装响应
+    };
+    DEFER_STATE m_deferState;
 };
 
 #endif  // _HTTP_CONN_H
\ No newline at end of file
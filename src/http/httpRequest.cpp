@@ -1,273 +1,753 @@
 #include "httpRequest.h"
 
-std::unordered_set<std::string> HttpRequest::DEFAULT_HTML {
-    "index", "login", "register", "welcome", "picture", "video", "error"
+// 与 KNOWN_HEADER 一一对应
+const char* const HttpRequest::KNOWN_HEADER_NAMES[] = {
+    "Connection",
+    "Content-Length",
+    "Content-Type",
+    "Transfer-Encoding",
+    "Accept-Encoding",
+    "Range",
+    "If-Range",
+    "If-None-Match",
+    "If-Modified-Since",
 };
 
+// RFC 9110 tchar，请求方法与请求头名称的合法字符
+static const std::array<bool, 256> TOKEN_CHARS = [] {
+    std::array<bool, 256> table = {};
+
+    for (int ch = 0; ch < 256; ch++)
+        table[ch] = isalnum(ch) != 0;
+    for (const char* p = "!#$%&'*+-.^_`|~"; *p; p++)
+        table[static_cast<unsigned char>(*p)] = true;
+
+    return table;
+}();
+
+static const char* const PARSE_ERROR_MSG[] = {
+    "no error",
+    "invalid method",
+    "invalid request target",
+    "invalid http version",
+    "CR not followed by LF",
+    "invalid header field",
+    "invalid Content-Length",
+    "line too long",
+    "too many header fields",
+    "invalid Transfer-Encoding",
+    "unsupported Transfer-Encoding",
+    "invalid chunk",
+    "body too large",
+    "body rejected by handler",
+};
+
+size_t HttpRequest::s_maxBodySize = MAX_BODY_SIZE;
+std::unordered_map<std::string, HttpRequest::BodyHandler> HttpRequest::s_bodyHandlers;
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
 void HttpRequest::init() {
-    m_requestInfo = std::make_unique<RequestInfo>();
     m_parsePhase = _REQUEST_LINE;
+    m_state = _LINE_START;
+    m_error = _NO_ERROR;
+    m_parsedBytes = 0;
+    m_tokenStart = 0;
+    m_lineLen = 0;
+
+    m_base = nullptr;
+    m_method = m_path = m_version = m_body = { 0, 0 };
+
+    m_headerNums = 0;
+    std::fill(m_knownHeaders, m_knownHeaders + _KNOWN_HEADER_NUMS, -1);
+
+    m_contentLength = 0;
+    m_hasContentLength = false;
+    m_isKeepAlive = false;
+
+    m_bodyState = _CONTENT;
+    m_bodyEnd = 0;
+    m_bodyRemain = 0;
+    m_bodyReceived = 0;
+    m_chunkDigits = 0;
+    m_bodyHandler = nullptr;
+
+    if (!m_postData.empty())
+        m_postData.clear();
 }
 
 /**
- * @brief 解析http请求
+ * @brief 解析http请求，只消费一个请求，其后流水线中的请求留在缓冲区
+ *
+ * 请求行与请求头逐字节推进状态机，解析状态保留在对象中，数据不完整时下次读入后从断点继续，
+ * 不会重复扫描已解析的字节；请求完整前其字节一直留在缓冲区头部
+ * 各字段只记录在请求中的位置，不做拷贝
+ *
+ * @return true  请求解析完成，其字节已从缓冲区取走
+ * @return false 数据不完整(error() 为 _NO_ERROR)，或解析出错
  */
 bool HttpRequest::parse(Buffer& buff) {
-    if (buff.readableBytes() <= 0)
+    // 上一个请求已完成或出错，开始解析新请求
+    if (m_parsePhase == _FINISH || m_error != _NO_ERROR)
+        init();
+
+    // 请求间多余的空行直接丢弃，使缓冲区总是从请求行开始
+    if (m_state == _LINE_START) {
+        while (buff.readableBytes() && (*buff.peek() == '\r' || *buff.peek() == '\n'))
+            buff.retrieve(1);
+    }
+
+    m_base = buff.peek();
+    const char* end = m_base + buff.readableBytes();
+
+    if (m_parsePhase < _BODY) {
+        m_parsedBytes = _parseHead(m_base + m_parsedBytes, end) - m_base;
+        m_body = { m_parsedBytes, 0 };
+        m_bodyEnd = m_parsedBytes;
+    }
+
+    if (m_parsePhase == _BODY && m_error == _NO_ERROR) {
+        m_parsedBytes = _parseBody(m_base + m_parsedBytes, end) - m_base;
+
+        if (m_bodyHandler && m_error == _NO_ERROR)
+            _deliverBody(buff);
+    }
+
+    if (m_error != _NO_ERROR) {
+        std::string msg = std::string("bad request: ") + errorMessage();
+        Logger::Instance()->LOG_ERROR(msg);
         return false;
+    }
+
+    if (m_parsePhase != _FINISH)
+        return false;
+
+    m_body.len = m_bodyEnd - m_body.offset;
+    if (!m_bodyHandler)
+        m_bodyReceived = m_body.len;
 
-    const char CRLF[] = "\r\n";
-    
-    while (buff.readableBytes() && m_parsePhase < _FINISH) {
-        const char* lineEndPos = std::search(buff.peek(), buff.peek() + buff.readableBytes(), CRLF, CRLF + 2);
-        std::string lineStr(buff.peek(), lineEndPos);
+    if (m_body.len)
+        _parseForm();
 
-        switch(m_parsePhase) {
-            case _REQUEST_LINE:
-                if (!_parseRequestLine(lineStr)) return false;
-                _parsePath();
+    // 请求字节已取走，但在下次读入前内存不会被覆盖，视图仍然有效
+    buff.retrieve(m_parsedBytes);
+    m_parsedBytes = 0;
+
+    return true;
+}
+
+/**
+ * @brief 推进请求行与请求头的状态机，连续的合法字符一次跳过，只记录词法单元的起止
+ *
+ * @return 解析停止的位置: 请求头结束、出错或数据耗尽
+ */
+const char* HttpRequest::_parseHead(const char* p, const char* end) {
+    auto fail = [this](PARSE_ERROR error) {
+        m_error = error;
+    };
+    auto offset = [this](const char* pos) {
+        return static_cast<size_t>(pos - m_base);
+    };
+
+    while (p < end && m_parsePhase < _BODY && m_error == _NO_ERROR) {
+        const char* q = p;
+
+        switch (m_state) {
+            case _LINE_START:
+                if (*p == '\r' || *p == '\n') {
+                    p++;    // 请求间多余的空行
+                    break;
+                }
+                m_lineLen = 0;
+                m_tokenStart = offset(p);
+                m_state = _METHOD;
+                break;
+
+            case _METHOD:
+                while (q < end && TOKEN_CHARS[static_cast<unsigned char>(*q)]) q++;
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_REQUEST_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else if (*p != ' ' || offset(p) == m_tokenStart)
+                    fail(_BAD_METHOD);
+                else {
+                    m_method = { m_tokenStart, offset(p) - m_tokenStart };
+                    p++;
+                    m_lineLen++;
+                    m_tokenStart = offset(p);
+                    m_state = _PATH;
+                }
                 break;
-            case _HEADERS:
-                _parseHeaders(lineStr);
+
+            case _PATH:
+                q = HttpScanner::findTokenEnd(p, end);
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_REQUEST_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else if (*p != ' ' || offset(p) == m_tokenStart)
+                    fail(_BAD_URI);
+                else {
+                    m_path = { m_tokenStart, offset(p) - m_tokenStart };
+                    p++;
+                    m_lineLen++;
+                    m_tokenStart = offset(p);
+                    m_state = _VERSION;
+                }
+                break;
+
+            case _VERSION:
+                q = HttpScanner::findLineEnd(p, end);
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_REQUEST_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else {
+                    m_version = { m_tokenStart, offset(p) - m_tokenStart };
+
+                    if (*p++ == '\r')
+                        m_state = _REQUEST_LINE_LF;
+                    else
+                        _finishRequestLine();   // 容许单独的LF作为行尾
+                }
+                break;
+
+            case _REQUEST_LINE_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    _finishRequestLine();
                 break;
-            case _BODY:
-                _parseBody(lineStr);
+
+            case _HEADER_START:
+                if (*p == '\r') {
+                    p++;
+                    m_state = _HEADERS_END_LF;
+                }
+                else if (*p == '\n') {
+                    p++;
+                    _finishHeaders();
+                }
+                else if (*p == ' ' || *p == '\t')
+                    fail(_BAD_HEADER);      // 不支持已废弃的折行
+                else if (m_headerNums == MAX_HEADERS)
+                    fail(_TOO_MANY_HEADERS);
+                else {
+                    m_lineLen = 0;
+                    m_tokenStart = offset(p);
+                    m_state = _HEADER_NAME;
+                }
                 break;
-            default:
+
+            case _HEADER_NAME:
+                q = HttpScanner::findHeaderNameEnd(p, end);
+                if (!std::all_of(p, q, [](char ch) { return TOKEN_CHARS[static_cast<unsigned char>(ch)]; })) {
+                    fail(_BAD_HEADER);
+                    break;
+                }
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_HEADER_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else if (*p != ':' || offset(p) == m_tokenStart)
+                    fail(_BAD_HEADER);
+                else {
+                    m_headers[m_headerNums].name = { m_tokenStart, offset(p) - m_tokenStart };
+                    p++;
+                    m_lineLen++;
+                    m_tokenStart = offset(p);
+                    m_state = _HEADER_VALUE;
+                }
+                break;
+
+            case _HEADER_VALUE:
+                q = HttpScanner::findHeaderValueEnd(p, end);
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_HEADER_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else if (*p == '\r' || *p == '\n') {
+                    m_headers[m_headerNums].value = { m_tokenStart, offset(p) - m_tokenStart };
+
+                    if (*p++ == '\r')
+                        m_state = _HEADER_LF;
+                    else
+                        _finishHeader();
+                }
+                else
+                    fail(_BAD_HEADER);
+                break;
+
+            case _HEADER_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    _finishHeader();
+                break;
+
+            case _HEADERS_END_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    _finishHeaders();
                 break;
         }
-        
-        if (lineEndPos > buff.peek() + buff.readableBytes())
-            break;
+    }
+
+    return p;
+}
+
+/**
+ * @brief 请求行读完: 校验版本号 HTTP/x.y，只保留 x.y
+ */
+bool HttpRequest::_finishRequestLine() {
+    std::string_view version = view(m_version);
 
-        buff.retrieveUntil((lineEndPos == buff.peek() + buff.readableBytes()) ? lineEndPos : lineEndPos + 2);
+    if (version.size() != 8 || version.substr(0, 5) != "HTTP/"
+        || !isdigit(version[5]) || version[6] != '.' || !isdigit(version[7])) {
+        m_error = _BAD_VERSION;
+        return false;
     }
 
+    m_version.offset += 5;
+    m_version.len -= 5;
+
+    m_parsePhase = _HEADERS;
+    m_state = _HEADER_START;
     return true;
 }
 
-bool HttpRequest::_parseRequestLine(const std::string& lineStr) {
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    std::smatch matchRes;
+/**
+ * @brief 一个请求头读完: 去除值两端空白，常用请求头记入下标，Content-Length 须为十进制数且多次出现时一致
+ */
+bool HttpRequest::_finishHeader() {
+    HeaderSlot& slot = m_headers[m_headerNums];
+    std::string_view name = view(slot.name);
 
-    if (regex_match(lineStr, matchRes, patten)) {
-        m_requestInfo->method = matchRes[1];
-        m_requestInfo->path = matchRes[2];
-        m_requestInfo->version = matchRes[3];
+    while (slot.value.len && (m_base[slot.value.offset] == ' ' || m_base[slot.value.offset] == '\t')) {
+        slot.value.offset++;
+        slot.value.len--;
+    }
+    while (slot.value.len && (m_base[slot.value.offset + slot.value.len - 1] == ' ' || m_base[slot.value.offset + slot.value.len - 1] == '\t'))
+        slot.value.len--;
 
-        m_parsePhase = _HEADERS;
-        return true;
+    for (int i = 0; i < _KNOWN_HEADER_NUMS; i++) {
+        if (equalsIgnoreCase(name, KNOWN_HEADER_NAMES[i])) {
+            m_knownHeaders[i] = m_headerNums;
+            break;
+        }
     }
-    Logger::Instance()->LOG_ERROR("happened error in parsing requestLine");
 
-    return false;
-}
+    if (m_knownHeaders[_CONTENT_LENGTH] == static_cast<int>(m_headerNums)) {
+        std::string_view value = view(slot.value);
+        size_t contentLength = 0;
 
-void HttpRequest::_parsePath() {
-    if (m_requestInfo->path == "/")
-        m_requestInfo->path = "/index.html";
-    else {
-        for (auto& dh : DEFAULT_HTML) {
-            if (dh == m_requestInfo->path) {
-                m_requestInfo->path += ".html";
-                break;
-            }
+        if (value.empty() || value.size() > 18 || value.find_first_not_of("0123456789") != std::string_view::npos) {
+            m_error = _BAD_CONTENT_LENGTH;
+            return false;
+        }
+
+        for (char ch : value)
+            contentLength = contentLength * 10 + (ch - '0');
+
+        if (m_hasContentLength && contentLength != m_contentLength) {
+            m_error = _BAD_CONTENT_LENGTH;
+            return false;
         }
-    }
-}
 
-void HttpRequest::_parseHeaders(const std::string& lineStr) {
-    std::regex pattern("^([^:]*): ?(.*)$");
-    std::smatch matchRes;
+        m_contentLength = contentLength;
+        m_hasContentLength = true;
+    }
 
-    if (regex_match(lineStr, matchRes, pattern)) 
-        m_requestInfo->headers[matchRes[1]] = matchRes[2];
-    else
-        m_parsePhase = _BODY;
+    m_headerNums++;
+    m_state = _HEADER_START;
+    return true;
 }
 
-void HttpRequest::_parseBody(const std::string& lineStr) {
-    if (m_requestInfo->method == "POST" && m_requestInfo->headers["Content-Type"].find("application/x-www-form-urlencoded") != std::string::npos && lineStr.length()) {
-        m_requestInfo->body = lineStr;
-        _urlDecode();
+/**
+ * @brief 空行结束请求头，确定请求体的分帧方式: 分块、Content-Length 或无请求体
+ *
+ * 同时出现 Transfer-Encoding 与 Content-Length 的请求可能被用于请求走私，直接拒绝
+ */
+void HttpRequest::_finishHeaders() {
+    m_isKeepAlive = equalsIgnoreCase(header(_CONNECTION), "keep-alive") && version() == "1.1";
 
-        bool flag = false;
-        std::string user = m_requestInfo->postData["username"];
-        std::string password = m_requestInfo->postData["password"];
+    std::string_view transferEncoding = header(_TRANSFER_ENCODING);
 
-        if (m_requestInfo->postData["isLogin"] == "1")
-            flag = userLogin(user, password);
-        else
-            flag = userRegister(user, password);
+    if (!s_bodyHandlers.empty() && (!transferEncoding.empty() || m_contentLength > 0)) {
+        auto it = s_bodyHandlers.find(std::string(path()));
+        if (it != s_bodyHandlers.end())
+            m_bodyHandler = &it->second;
+    }
 
-        m_requestInfo->path = flag ? "/welcome.html" : "/error.html";
+    if (!transferEncoding.empty()) {
+        if (m_hasContentLength)
+            m_error = _BAD_TRANSFER_ENCODING;
+        else if (!equalsIgnoreCase(transferEncoding, "chunked"))
+            m_error = _UNSUPPORTED_TRANSFER_ENCODING;  // 不支持其他传输编码
+        else {
+            m_bodyState = _CHUNK_SIZE;
+            m_parsePhase = _BODY;
+        }
+        return;
     }
 
-    m_parsePhase = _FINISH;
-}
+    if (m_contentLength == 0) {
+        m_parsePhase = _FINISH;
+        return;
+    }
 
-void HttpRequest::_urlDecode() {
-    std::string tmp = "";
-    int length = m_requestInfo->body.length();
-
-    for (int i = 0; i < length; i++) {
-        char ch = m_requestInfo->body[i];
-        
-        if (ch == '+')
-            tmp += ' ';
-        else if (ch == '%') {
-            assert(i + 2 < length);
-            char high = _fromChar(m_requestInfo->body[++i]);
-            char low = _fromChar(m_requestInfo->body[++i]);
-
-            tmp += high * 16 + low;
-        } else
-            tmp += ch;
+    // 长度已知时无需等到请求体读完即可拒绝
+    if (!m_bodyHandler && m_contentLength > s_maxBodySize) {
+        m_error = _BODY_TOO_LARGE;
+        return;
     }
 
-    m_requestInfo->body = tmp;
-    
-    // post data resolved 
-    std::string key, value, msg;
-    int l = 0, r = 0;
-    int len = m_requestInfo->body.length();
+    m_bodyState = _CONTENT;
+    m_bodyRemain = m_contentLength;
+    m_parsePhase = _BODY;
+}
+
+/**
+ * @brief 推进请求体的状态机，请求体数据前移至 m_bodyEnd，分块格式被原地覆盖
+ *
+ * @return 解析停止的位置: 请求体结束、出错或数据耗尽
+ */
+const char* HttpRequest::_parseBody(const char* p, const char* end) {
+    char* base = const_cast<char*>(m_base);     // 读缓冲区归本连接所有，原地改写
+
+    auto fail = [this](PARSE_ERROR error) {
+        m_error = error;
+    };
+
+    while (p < end && m_parsePhase == _BODY && m_error == _NO_ERROR) {
+        switch (m_bodyState) {
+            case _CONTENT:
+            case _CHUNK_DATA: {
+                size_t n = std::min<size_t>(m_bodyRemain, end - p);
+
+                if (!m_bodyHandler && m_bodyEnd - m_body.offset + n > s_maxBodySize) {
+                    fail(_BODY_TOO_LARGE);
+                    break;
+                }
+
+                if (base + m_bodyEnd != p)
+                    memmove(base + m_bodyEnd, p, n);
+
+                m_bodyEnd += n;
+                m_bodyRemain -= n;
+                p += n;
+
+                if (m_bodyRemain == 0) {
+                    if (m_bodyState == _CONTENT)
+                        m_parsePhase = _FINISH;
+                    else
+                        m_bodyState = _CHUNK_DATA_CR;
+                }
+                break;
+            }
 
-    for (; r < len; r++) {
-        char ch = m_requestInfo->body[r];
+            case _CHUNK_SIZE:
+                if (isxdigit(static_cast<unsigned char>(*p))) {
+                    if (++m_chunkDigits > 15) {     // 超出size_t表示范围
+                        fail(_BAD_CHUNK);
+                        break;
+                    }
+                    m_bodyRemain = m_bodyRemain * 16 + (isdigit(*p) ? *p - '0' : tolower(*p) - 'a' + 10);
+                    p++;
+                }
+                else if (m_chunkDigits == 0)
+                    fail(_BAD_CHUNK);
+                else if (*p == ';' || *p == ' ' || *p == '\t') {
+                    m_lineLen = 0;
+                    m_bodyState = _CHUNK_EXT;
+                }
+                else if (*p == '\r') {
+                    p++;
+                    m_bodyState = _CHUNK_SIZE_LF;
+                }
+                else if (*p == '\n') {
+                    p++;
+                    _finishChunkSize();
+                }
+                else
+                    fail(_BAD_CHUNK);
+                break;
 
-        switch (ch) {
-            case '=':
-                key = m_requestInfo->body.substr(l, r - l);
-                l = r + 1;
+            case _CHUNK_EXT: {
+                // 块扩展不做解释，跳过至行尾
+                const char* q = HttpScanner::findLineEnd(p, end);
+                m_lineLen += q - p;
+                p = q;
+
+                if (m_lineLen > MAX_HEADER_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (p == end)
+                    break;
+                else if (*p++ == '\r')
+                    m_bodyState = _CHUNK_SIZE_LF;
+                else
+                    _finishChunkSize();
                 break;
-            case '&':
-                value = m_requestInfo->body.substr(l, r - l);
-                l = r + 1;
-                m_requestInfo->postData[key] = value;
+            }
 
-                msg = key + " = " + value;
-                Logger::Instance()->LOG_DEBUG(msg);
+            case _CHUNK_SIZE_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    _finishChunkSize();
                 break;
-            default:
+
+            case _CHUNK_DATA_CR:
+                if (*p == '\r') {
+                    p++;
+                    m_bodyState = _CHUNK_DATA_LF;
+                }
+                else if (*p == '\n') {
+                    p++;
+                    m_bodyState = _CHUNK_SIZE;
+                }
+                else
+                    fail(_BAD_CHUNK);
                 break;
-        }
-    }
 
-    if (m_requestInfo->postData.count(key) == 0 && r > l) 
-        m_requestInfo->postData[key] = m_requestInfo->body.substr(l, r - l);
-}
+            case _CHUNK_DATA_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    m_bodyState = _CHUNK_SIZE;
+                break;
 
-char HttpRequest::_fromChar (char ch) { 
-    char ret;
-    if (ch >= 'A' && ch <= 'Z') ret = ch - 'A' + 10;
-    else if (ch >= 'a' && ch <= 'z') ret = ch - 'a' + 10;
-    else if (ch >= '0' && ch <= '9') ret = ch - '0';
-    else assert(0);
+            case _TRAILER_START:
+                if (*p == '\r') {
+                    p++;
+                    m_bodyState = _TRAILER_END_LF;
+                }
+                else if (*p == '\n') {
+                    p++;
+                    m_parsePhase = _FINISH;
+                }
+                else {
+                    m_lineLen = 0;
+                    m_bodyState = _TRAILER_LINE;
+                }
+                break;
 
-    return ret;
-}
+            case _TRAILER_LINE: {
+                // 尾部字段不做解释，跳过整行
+                const char* q = static_cast<const char*>(memchr(p, '\n', end - p));
+                m_lineLen += (q ? q : end) - p;
+                p = q ? q + 1 : end;
 
-bool HttpRequest::userLogin(const std::string& usr, const std::string& psw) {
-    bool flag = false;
+                if (m_lineLen > MAX_HEADER_LINE)
+                    fail(_LINE_TOO_LONG);
+                else if (q)
+                    m_bodyState = _TRAILER_START;
+                break;
+            }
 
-    if (usr == "" || psw == "") return flag;
-    
-    std::string msg = "check login: " + usr + " && " + psw;
-    Logger::Instance()->LOG_DEBUG(msg);
+            case _TRAILER_END_LF:
+                if (*p++ != '\n')
+                    fail(_BAD_LINE_ENDING);
+                else
+                    m_parsePhase = _FINISH;
+                break;
+        }
+    }
 
-    MYSQL* conn = SqlConnPool::Instance()->getConn();
-    assert(conn);
+    return p;
+}
 
-    char sqlStr[256];
-    MYSQL_RES* res = nullptr;
+/**
+ * @brief 块大小行读完，大小为0的块之后是尾部字段
+ */
+void HttpRequest::_finishChunkSize() {
+    m_bodyState = m_bodyRemain == 0 ? _TRAILER_START : _CHUNK_DATA;
+    m_chunkDigits = 0;
+}
 
-    snprintf(sqlStr, 256, "SELECT username, password FROM login Where username = '%s' LIMIT 1", usr.data());
+/**
+ * @brief 将已收到的请求体交付处理函数，并从读缓冲区中移除，请求头仍保留
+ */
+void HttpRequest::_deliverBody(Buffer& buff) {
+    size_t n = m_bodyEnd - m_body.offset;
 
-    msg = "check sql: " + std::string(sqlStr);
-    Logger::Instance()->LOG_DEBUG(msg);
+    if (n) {
+        if (!(*m_bodyHandler)(*this, view({ m_body.offset, n }), false)) {
+            m_error = _BODY_REJECTED;
+            return;
+        }
 
-    if (mysql_query(conn, sqlStr)) {
-        mysql_free_result(res);
-        SqlConnPool::Instance()->freeConn(conn);
-        return false;
+        buff.erase(m_body.offset, n);
+        m_parsedBytes -= n;
+        m_bodyEnd = m_body.offset;
+        m_bodyReceived += n;
     }
 
-    res = mysql_store_result(conn);
+    if (m_parsePhase == _FINISH && !(*m_bodyHandler)(*this, std::string_view(), true))
+        m_error = _BODY_REJECTED;
+}
+
+HttpRequest::PARSE_ERROR HttpRequest::error() const {
+    return m_error;
+}
 
-    while (MYSQL_ROW row = mysql_fetch_row(res)) {
-        std::string psw_(row[1]);
+const char* HttpRequest::errorMessage() const {
+    return PARSE_ERROR_MSG[m_error];
+}
 
-        flag = psw == psw_;
+/**
+ * @brief 解析错误对应的响应状态码
+ */
+int HttpRequest::errorStatus() const {
+    switch (m_error) {
+        case _BODY_TOO_LARGE:
+            return 413;
+        case _UNSUPPORTED_TRANSFER_ENCODING:
+            return 501;
+        default:
+            return 400;
     }
+}
 
-    SqlConnPool::Instance()->freeConn(conn);
+void HttpRequest::registerBodyHandler(const std::string& path, BodyHandler handler) {
+    s_bodyHandlers[path] = std::move(handler);
+}
 
-    return flag;
+std::string_view HttpRequest::view(const Span& span) const {
+    return std::string_view(m_base + span.offset, span.len);
 }
 
-bool HttpRequest::userRegister(const std::string& usr, const std::string& psw) {
-    bool flag = false;
+/**
+ * @brief urlencoded 表单解码至 m_postData，表单的处理由路由到的处理函数完成
+ */
+void HttpRequest::_parseForm() {
+    if (method() == "POST" && header(_CONTENT_TYPE).find("application/x-www-form-urlencoded") != std::string_view::npos)
+        _urlDecode(view(m_body));
+}
 
-    if (usr == "" || psw == "") return flag;
-    
-    std::string msg = "register: " + usr + " && " + psw;
-    Logger::Instance()->LOG_DEBUG(msg);
+/**
+ * @brief 解析表单: 先按 '&' '=' 切分，再对各键值原地解码，解码只改写读缓冲区中的请求体
+ */
+void HttpRequest::_urlDecode(std::string_view body) {
+    char* p = const_cast<char*>(body.data());
+    char* end = p + body.size();
 
-    MYSQL* conn = SqlConnPool::Instance()->getConn();
-    assert(conn);
+    while (p < end) {
+        char* pairEnd = static_cast<char*>(memchr(p, '&', end - p));
+        if (!pairEnd)
+            pairEnd = end;
 
-    char sqlStr[256];
-    MYSQL_RES* res = nullptr;
+        char* eq = static_cast<char*>(memchr(p, '=', pairEnd - p));
+        char* keyEnd = eq ? eq : pairEnd;
+        char* value = eq ? eq + 1 : pairEnd;
 
-    snprintf(sqlStr, 256, "SELECT username FROM login Where username = '%s' LIMIT 1", usr.data());
+        std::string key(p, HttpScanner::urlDecode(p, keyEnd - p));
+        if (!key.empty() && m_postData.count(key) == 0) {
+            m_postData[key] = std::string(value, HttpScanner::urlDecode(value, pairEnd - value));
 
-    msg = "sql: " + std::string(sqlStr);
-    Logger::Instance()->LOG_DEBUG(msg);
+            std::string msg = key + " = " + m_postData[key];
+            Logger::Instance()->LOG_DEBUG(msg);
+        }
 
-    if (mysql_query(conn, sqlStr)) {
-        mysql_free_result(res);
-        SqlConnPool::Instance()->freeConn(conn);
-        
-        return false;
+        p = pairEnd + 1;
     }
+}
 
-    res = mysql_store_result(conn);
-    if (res->row_count == 0) {
-        bzero(sqlStr, 256);
-        snprintf(sqlStr, 256, "INSERT INTO login(username, password) VALUES('%s', '%s')", usr.data(), psw.data());
+std::string_view HttpRequest::method() const {
+    return view(m_method);
+}
 
-        std::string msg = "register sql: " + usr + " && " + psw;
-        Logger::Instance()->LOG_INFO(msg);
+std::string_view HttpRequest::path() const {
+    return view(m_path);
+}
 
-        if (mysql_query(conn, sqlStr)) {
-            Logger::Instance()->LOG_DEBUG("register error");
-            flag =false;
-        }
+std::string_view HttpRequest::version() const {
+    return view(m_version);
+}
 
-        flag = true;
+// 请求头不存在时返回空视图
+std::string_view HttpRequest::header(KNOWN_HEADER key) const {
+    int idx = m_knownHeaders[key];
+
+    return idx < 0 ? std::string_view() : view(m_headers[idx].value);
+}
+
+/**
+ * @brief 按名称查找请求头，名称不区分大小写
+ */
+std::string_view HttpRequest::header(std::string_view key) const {
+    for (size_t i = 0; i < m_headerNums; i++) {
+        if (equalsIgnoreCase(view(m_headers[i].name), key))
+            return view(m_headers[i].value);
     }
 
-    SqlConnPool::Instance()->freeConn(conn);
+    return std::string_view();
+}
 
-    return flag;
+std::string_view HttpRequest::body() const {
+    return view(m_body);
 }
 
+std::string_view HttpRequest::formValue(std::string_view key) const {
+    auto it = m_postData.find(std::string(key));
 
-std::string HttpRequest::method() const {
-    return m_requestInfo->method;
+    return it == m_postData.end() ? std::string_view() : it->second;
 }
 
-std::string HttpRequest::path() const {
-    return m_requestInfo->path;
+size_t HttpRequest::bodyLength() const {
+    return m_bodyReceived;
 }
 
-std::string HttpRequest::version() const {
-    return m_requestInfo->version;
+/**
+ * @brief 客户端是否接受gzip编码(Accept-Encoding中含gzip且q不为0)
+ */
+bool HttpRequest::acceptsGzip() const {
+    std::string_view value = header(_ACCEPT_ENCODING);
+
+    for (size_t pos = value.find("gzip"); pos != std::string_view::npos; pos = value.find("gzip", pos + 4)) {
+        size_t end = value.find(',', pos);
+        std::string_view param = value.substr(pos + 4, end == std::string_view::npos ? std::string_view::npos : end - pos - 4);
+
+        while (!param.empty() && param.front() == ' ') param.remove_prefix(1);
+        if (param.empty() || param.front() != ';')
+            return true;
+
+        // gzip;q=0 表示明确拒绝
+        param.remove_prefix(1);
+        while (!param.empty() && param.front() == ' ') param.remove_prefix(1);
+        if (param.substr(0, 2) != "q=")
+            return true;
+
+        param = param.substr(2, param.find_first_of(" ;", 2) - 2);
+        if (param.empty() || param.find_first_not_of("0.") != std::string_view::npos)
+            return true;
+    }
+
+    return false;
 }
 
 bool HttpRequest::isKeepAlive() const {
-    if (m_requestInfo->headers.count("Connection") == 1)
-        return m_requestInfo->headers.find("Connection")->second == "keep-alive" && m_requestInfo->version == "1.1";
+    if (m_error != _NO_ERROR)
+        return false;   // 无法定位下一个请求的起点
 
-    return false;
+    return m_isKeepAlive;
 }
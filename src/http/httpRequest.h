@@ -1,17 +1,24 @@
 #ifndef _HTTP_REQUEST_H
 #define _HTTP_REQUEST_H
 
-#include <memory>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <strings.h>
+#include <cctype>
 #include <unordered_map>
-#include <unordered_set>
-#include <mysql/mysql.h>
+#include <functional>
 
-#include "../pool/sqlConnPool.h"
+#include "httpScanner.h"
 #include "../buffer/buffer.h"
 #include "../logger/logger.h"
 
+#define MAX_REQUEST_LINE    8192    // 请求行长度上限
+#define MAX_HEADER_LINE     8192    // 单个请求头长度上限
+#define MAX_HEADERS         64      // 请求头数量上限
+#define MAX_BODY_SIZE       (1 << 20)   // 缓存于读缓冲区的请求体上限，流式交付的请求体不受限
+
 class HttpRequest {
 public:
     enum PARSE_PHASE {
@@ -21,47 +28,156 @@ public:
         _FINISH
     };
 
+    enum PARSE_ERROR {
+        _NO_ERROR,
+        _BAD_METHOD,
+        _BAD_URI,
+        _BAD_VERSION,
+        _BAD_LINE_ENDING,
+        _BAD_HEADER,
+        _BAD_CONTENT_LENGTH,
+        _LINE_TOO_LONG,
+        _TOO_MANY_HEADERS,
+        _BAD_TRANSFER_ENCODING,
+        _UNSUPPORTED_TRANSFER_ENCODING,
+        _BAD_CHUNK,
+        _BODY_TOO_LARGE,
+        _BODY_REJECTED
+    };
+
+    // 常用请求头，解析时直接记入对应下标，无需查找
+    enum KNOWN_HEADER {
+        _CONNECTION,
+        _CONTENT_LENGTH,
+        _CONTENT_TYPE,
+        _TRANSFER_ENCODING,
+        _ACCEPT_ENCODING,
+        _RANGE,
+        _IF_RANGE,
+        _IF_NONE_MATCH,
+        _IF_MODIFIED_SINCE,
+        _KNOWN_HEADER_NUMS
+    };
+
+    /**
+     * @brief 流式接收请求体的处理函数，请求体到达后即交付，不在读缓冲区中积累
+     *
+     * @param data     本次到达的请求体(已去除分块格式)
+     * @param finished 请求体已结束，此时 data 为空
+     * @return false 拒绝该请求体，以400响应
+     */
+    using BodyHandler = std::function<bool(const HttpRequest& request, std::string_view data, bool finished)>;
+
     void init();
 
     bool parse(Buffer& buff);
-    std::string method() const;
-    std::string version() const;
-    std::string path() const;
+    PARSE_ERROR error() const;
+    const char* errorMessage() const;
+    int errorStatus() const;
+
+    // 须在服务启动前注册，运行期间只读
+    static void registerBodyHandler(const std::string& path, BodyHandler handler);
+    static size_t s_maxBodySize;
+
+    // 以下视图指向读缓冲区，在下一次向该缓冲区读入数据前有效
+    std::string_view method() const;
+    std::string_view version() const;
+    std::string_view path() const;
+    std::string_view header(KNOWN_HEADER key) const;
+    std::string_view header(std::string_view key) const;
+    std::string_view body() const;     // 流式交付时为空
+    std::string_view formValue(std::string_view key) const;    // urlencoded 表单字段，不存在时为空
+    size_t bodyLength() const;          // 已收到的请求体总长
 
     bool isKeepAlive() const;
+    bool acceptsGzip() const;
 
 private:
-    struct RequestInfo {
-        std::string method;
-        std::string path;
-        std::string version;
-        std::string body;
-
-        std::unordered_map<std::string, std::string> headers;
-        std::unordered_map<std::string, std::string> postData;
-
-        RequestInfo() {
-            method = path = version = body = "";
-            headers.clear();
-            postData.clear();
-        }
+    // 请求中的一段，记为相对请求起点的偏移，缓冲区扩容搬移数据后依然有效
+    struct Span {
+        size_t offset;
+        size_t len;
+    };
+
+    struct HeaderSlot {
+        Span name;
+        Span value;
+    };
+
+    // 逐字节解析的状态，在多次读之间保持
+    enum PARSE_STATE {
+        _LINE_START,        // 请求行之前，跳过请求间多余的空行
+        _METHOD,
+        _PATH,
+        _VERSION,
+        _REQUEST_LINE_LF,
+        _HEADER_START,
+        _HEADER_NAME,
+        _HEADER_VALUE,
+        _HEADER_LF,
+        _HEADERS_END_LF
+    };
+
+    // 请求体的解析状态
+    enum BODY_STATE {
+        _CONTENT,           // 按 Content-Length 读取
+        _CHUNK_SIZE,
+        _CHUNK_EXT,
+        _CHUNK_SIZE_LF,
+        _CHUNK_DATA,
+        _CHUNK_DATA_CR,
+        _CHUNK_DATA_LF,
+        _TRAILER_START,
+        _TRAILER_LINE,
+        _TRAILER_END_LF
     };
 
 private:
     PARSE_PHASE m_parsePhase;
-    std::unique_ptr<RequestInfo> m_requestInfo;
+    PARSE_STATE m_state;
+    PARSE_ERROR m_error;
+    size_t m_parsedBytes;   // 当前请求在读缓冲区中已解析的字节数，请求完整后才一并取走
+    size_t m_tokenStart;    // 正在解析的词法单元起点
+    size_t m_lineLen;       // 当前行已解析的长度
+
+    const char* m_base;     // 请求起点，每次解析时取自缓冲区
+    Span m_method;
+    Span m_path;
+    Span m_version;
+    Span m_body;
+
+    HeaderSlot m_headers[MAX_HEADERS];
+    size_t m_headerNums;
+    int m_knownHeaders[_KNOWN_HEADER_NUMS];     // 常用请求头在 m_headers 中的下标，-1 为不存在
+
+    size_t m_contentLength;
+    bool m_hasContentLength;
+    bool m_isKeepAlive;
+
+    // 请求体: 分块格式在读缓冲区内原地去除，已收到的请求体为 [m_body.offset, m_bodyEnd)
+    BODY_STATE m_bodyState;
+    size_t m_bodyEnd;
+    size_t m_bodyRemain;    // 当前块或 Content-Length 的剩余字节
+    size_t m_bodyReceived;
+    int m_chunkDigits;
+    const BodyHandler* m_bodyHandler;
+
+    std::unordered_map<std::string, std::string> m_postData;
 
-    bool _parseRequestLine(const std::string& str);
-    void _parsePath();
-    void _parseHeaders(const std::string& str);
-    void _parseBody(const std::string& str);
-    void _urlDecode();
-    char _fromChar(char ch);
+    std::string_view view(const Span& span) const;
 
-    bool userLogin(const std::string& user, const std::string& psw);
-    bool userRegister(const std::string& user, const std::string& psw);
+    const char* _parseHead(const char* begin, const char* end);
+    bool _finishRequestLine();
+    bool _finishHeader();
+    void _finishHeaders();
+    const char* _parseBody(const char* begin, const char* end);
+    void _finishChunkSize();
+    void _deliverBody(Buffer& buff);
+    void _parseForm();
+    void _urlDecode(std::string_view body);
 
-    static std::unordered_set<std::string> DEFAULT_HTML;
+    static const char* const KNOWN_HEADER_NAMES[];
+    static std::unordered_map<std::string, BodyHandler> s_bodyHandlers;
 };
 
 #endif  // _HTTP_REQUEST_H
@@ -1,160 +1,550 @@
 #include "httpResponse.h"
 #include <string>
 
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
+const HttpResponse::MimeType HttpResponse::MIME_TYPES[] = {
+    { "",       "text/plain",               true },
+    { ".html",  "text/html",                true },
+    { ".xml",   "text/xml",                 true },
+    { ".xhtml", "application/xhtml+xml",    true },
+    { ".txt",   "text/plain",               true },
+    { ".rtf",   "application/rtf",          false },
+    { ".pdf",   "application/pdf",          false },
+    { ".word",  "application/nsword",       false },
+    { ".png",   "image/png",                false },
+    { ".gif",   "image/gif",                false },
+    { ".jpg",   "image/jpeg",               false },
+    { ".jpeg",  "image/jpeg",               false },
+    { ".au",    "audio/basic",              false },
+    { ".mpeg",  "video/mpeg",               false },
+    { ".mpg",   "video/mpeg",               false },
+    { ".avi",   "video/x-msvideo",          false },
+    { ".gz",    "application/x-gzip",       false },
+    { ".tar",   "application/x-tar",        false },
+    { ".css",   "text/css",                 true },
+    { ".js",    "text/javascript",          true },
 };
 
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
+const int HttpResponse::MIME_NUMS = sizeof(MIME_TYPES) / sizeof(MIME_TYPES[0]);
+const int HttpResponse::MIME_MULTIPART = MIME_NUMS;
+
+const HttpResponse::CodeStatus HttpResponse::CODE_STATUS[] = {
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 405, "Method Not Allowed" },
+    { 413, "Payload Too Large" },
+    { 416, "Range Not Satisfiable" },
+    { 501, "Not Implemented" },
+    { 503, "Service Unavailable" },
 };
 
+const int HttpResponse::CODE_NUMS = sizeof(CODE_STATUS) / sizeof(CODE_STATUS[0]);
+
 const std::unordered_map<int, std::string> HttpResponse::CODE_ERR_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
+    { 503, "/503.html" },
 };
 
 HttpResponse::~HttpResponse() {
-    unmapFile();
+    releaseFile();
 }
 
-void HttpResponse::init(std::string srcDir, std::string path, bool isKeepAlive, int code) {
-    unmapFile();
+void HttpResponse::init(std::string_view srcDir, std::string_view path, bool isKeepAlive, int code, bool acceptGzip) {
+    releaseFile();
 
     m_srcDir = srcDir;
     m_path = path;
     m_isKeepAlive = isKeepAlive;
     m_code = code;
-    m_fileState = { 0 };
+    m_mime = 0;
+    m_acceptGzip = acceptGzip;
+    m_gzipped = false;
+
+    m_ifNoneMatch.clear();
+    m_ifModifiedSince.clear();
+
+    m_range.clear();
+    m_ifRange.clear();
+    m_ranges.clear();
+    m_bodyParts.clear();
+}
+
+/**
+ * @brief 记录请求中的条件头
+ *
+ * @param ifNoneMatch     If-None-Match
+ * @param ifModifiedSince If-Modified-Since
+ */
+void HttpResponse::setConditional(std::string_view ifNoneMatch, std::string_view ifModifiedSince) {
+    m_ifNoneMatch = ifNoneMatch;
+    m_ifModifiedSince = ifModifiedSince;
+}
+
+/**
+ * @brief 记录请求中的范围头
+ *
+ * @param range   Range
+ * @param ifRange If-Range
+ */
+void HttpResponse::setRange(std::string_view range, std::string_view ifRange) {
+    m_range = range;
+    m_ifRange = ifRange;
 }
 
 void HttpResponse::makeResponse(Buffer& buff) {
+    int err = 0;
 
-    if (stat((m_srcDir + m_path).data(), &m_fileState) < 0 || S_ISDIR(m_fileState.st_mode))
-        m_code = 404;
-    else if (!(m_fileState.st_mode & S_IROTH))
-        m_code = 403;
-    else
-        m_code = 200;
+    // 资源经由文件缓存获取，命中时无需 stat/open/mmap；请求本身有误时直接回应错误页
+    if (m_code == 200) {
+        m_file = FileCache::Instance()->acquire(m_srcDir + m_path, &err);
+
+        if (!m_file)
+            m_code = err == EACCES ? 403 : 404;
+    }
 
     if (CODE_ERR_PATH.count(m_code)) {
         m_path = CODE_ERR_PATH.find(m_code)->second;
-        stat((m_srcDir + m_path).data(), &m_fileState);
+        m_file = FileCache::Instance()->acquire(m_srcDir + m_path, &err);
     }
 
+    // 客户端支持时以缓存中的gzip副本替换原文件，范围请求总是针对原文件
+    if (m_file && m_acceptGzip && m_range.empty() && isCompressible()) {
+        if (std::shared_ptr<const CachedFile> gz = FileCache::Instance()->gzipped(m_file)) {
+            m_file = gz;
+            m_gzipped = true;
+        }
+    }
+
+    // 校验器来自缓存项，客户端副本仍有效时只回应答头
+    if (m_code == 200 && isNotModified())
+        m_code = 304;
+    else if (m_code == 200 && isRangeApplicable())
+        m_code = parseRanges(m_file->size()) ? (m_ranges.empty() ? 200 : 206) : 416;
+
+    // 无文件可发时响应体为内置的错误页
+    if (!m_file || m_code == 416)
+        m_mime = mimeIndex(".html");
+    else if (m_code == 206 && m_ranges.size() > 1)
+        m_mime = MIME_MULTIPART;
+    else
+        m_mime = mimeIndex(m_path);
+
     addStatusLine(buff);
     addHeaders(buff);
     addContent(buff);
 }
 
+/**
+ * @brief 状态行及固定头部(Connection/Keep-Alive/Content-Type/Vary/Server)整块取自预生成的模板
+ */
 void HttpResponse::addStatusLine(Buffer& buff) {
-    std::string status;
-
-    if (CODE_STATUS.count(m_code))
-        status = CODE_STATUS.find(m_code)->second;
-    else {
+    if (codeIndex(m_code) < 0)
         m_code = 400;
-        status = CODE_STATUS.find(m_code)->second;
-    }
 
-    buff.append("HTTP/1.1 " + std::to_string(m_code) + ' ' + status + CRLF);
+    const std::string& head = headTemplate(m_code, m_mime, m_isKeepAlive);
+    buff.append(head.data(), head.size());
 }
 
+/**
+ * @brief 随请求变化的头部: Date 及缓存项自带的校验器
+ */
 void HttpResponse::addHeaders(Buffer& buff) {
-    buff.append("Connection: ");
+    appendDate(buff);
+
+    if (m_file && (m_code == 200 || m_code == 206 || m_code == 304)) {
+        static const char ETAG[] = "ETag: ";
+        static const char LAST_MODIFIED[] = "Last-Modified: ";
+
+        buff.append(ETAG, sizeof(ETAG) - 1);
+        buff.append(m_file->etag().data(), m_file->etag().size());
+        buff.append(CRLF, 2);
+        buff.append(LAST_MODIFIED, sizeof(LAST_MODIFIED) - 1);
+        buff.append(m_file->lastModified().data(), m_file->lastModified().size());
+        buff.append(CRLF, 2);
+    }
 
-    if (m_isKeepAlive) {
-        buff.append(std::string("Keep-Alive") + CRLF);
-        buff.append("Keep-Alive: timeout=" + std::to_string(KEEP_ALIVE_TIMEOUT) + ", max=" + std::to_string(KEEP_ALIVE_MAX) + CRLF);
-    }else
-        buff.append(std::string("close") + CRLF);
+    if (m_file && (m_code == 200 || m_code == 206) && !m_gzipped) {
+        static const char ACCEPT_RANGES[] = "Accept-Ranges: bytes" CRLF;
+        buff.append(ACCEPT_RANGES, sizeof(ACCEPT_RANGES) - 1);
+    }
 
-    buff.append(std::string("Content-Type: ") + getFileType() + CRLF);
-    buff.append(std::string("Server: yfdHttpServer") + CRLF);
+    if (m_gzipped) {
+        static const char CONTENT_ENCODING[] = "Content-Encoding: gzip" CRLF;
+        buff.append(CONTENT_ENCODING, sizeof(CONTENT_ENCODING) - 1);
+    }
 }
 
 void HttpResponse::addContent(Buffer& buff) {
-    int fileFd = open((m_srcDir + m_path).data(), O_RDONLY);
+    if (m_code == 304) {
+        releaseFile();  // 304不带响应体
+        buff.append(CRLF);
+        return;
+    }
+
+    if (!m_file) {
+        replaceWithErrorContent(buff, m_code);
+        return;
+    }
 
-    if (fileFd < 0) {
-        replaceWithErrorContent(buff, "File not found");
+    if (m_code == 416) {
+        static const char CONTENT_RANGE[] = "Content-Range: bytes */";
+
+        buff.append(CONTENT_RANGE, sizeof(CONTENT_RANGE) - 1);
+        appendNumber(buff, m_file->size());
+        buff.append(CRLF, 2);
+        releaseFile();
+        replaceWithErrorContent(buff, m_code);
+        return;
+    }
+
+    if (m_code == 206) {
+        addRangeContent(buff);
         return;
     }
 
-    std::string msg = "load file path: " + m_srcDir + m_path;
-    Logger::Instance()->LOG_DEBUG(msg);
+    static const char CONTENT_LENGTH[] = "Content-length: ";
+
+    buff.append(CONTENT_LENGTH, sizeof(CONTENT_LENGTH) - 1);
+    appendNumber(buff, m_file->size());
+    buff.append(CRLF CRLF, 4);
+    m_bodyParts.push_back({ false, 0, m_file->size() });
+}
+
+/**
+ * @brief 组装206响应体: 单区间直接引用文件片段，多区间以multipart/byteranges分隔
+ *
+ * 文件内容不做拷贝，只记录片段位置，由连接以writev或sendfile发出
+ */
+void HttpResponse::addRangeContent(Buffer& buff) {
+    const std::string total = std::to_string(m_file->size());
+
+    if (m_ranges.size() == 1) {
+        auto [first, last] = m_ranges[0];
 
-    // 将资源文件进行内存映射
-    int* mmRet = (int*)mmap(nullptr, m_fileState.st_size, PROT_READ, MAP_PRIVATE, fileFd, 0);
-    if (*mmRet == -1) {
-        replaceWithErrorContent(buff, "File not found");
+        buff.append("Content-Range: bytes " + std::to_string(first) + '-' + std::to_string(last) + '/' + total + CRLF);
+        buff.append("Content-length: " + std::to_string(last - first + 1) + CRLF + CRLF);
+        m_bodyParts.push_back({ false, first, last - first + 1 });
         return;
     }
 
-    m_memoryMappingFile = (char*)mmRet;
-    close(fileFd);
+    // 各区间的分隔头先行生成，以便计算总长度
+    std::vector<std::string> partHeads;
+    size_t length = 0;
 
-    buff.append("Content-length: " + std::to_string(m_fileState.st_size) + CRLF + CRLF);
+    for (auto [first, last] : m_ranges) {
+        partHeads.push_back(std::string(CRLF) + "--" + BYTERANGES_BOUNDARY + CRLF
+            + "Content-Type: " + getFileType() + CRLF
+            + "Content-Range: bytes " + std::to_string(first) + '-' + std::to_string(last) + '/' + total + CRLF + CRLF);
+
+        length += partHeads.back().size() + last - first + 1;
+    }
+
+    const std::string tail = std::string(CRLF) + "--" + BYTERANGES_BOUNDARY + "--" + CRLF;
+    length += tail.size();
+
+    buff.append("Content-length: " + std::to_string(length) + CRLF + CRLF);
+
+    for (size_t i = 0; i < m_ranges.size(); i++) {
+        m_bodyParts.push_back({ true, buff.readableBytes(), partHeads[i].size() });
+        buff.append(partHeads[i]);
+
+        m_bodyParts.push_back({ false, m_ranges[i].first, m_ranges[i].second - m_ranges[i].first + 1 });
+    }
+
+    m_bodyParts.push_back({ true, buff.readableBytes(), tail.size() });
+    buff.append(tail);
+}
+
+const char* HttpResponse::getFileType() const {
+    return MIME_TYPES[mimeIndex(m_path)].type;
 }
 
-const std::string HttpResponse::getFileType() const {
-    std::string::size_type index = m_path.find_last_of('.');
+bool HttpResponse::isCompressible() const {
+    return MIME_TYPES[mimeIndex(m_path)].compressible;
+}
+
+/**
+ * @brief 按路径后缀查找MIME类型下标，未知后缀为缺省类型
+ */
+int HttpResponse::mimeIndex(const std::string& path) {
+    std::string::size_type index = path.find_last_of('.');
 
     if (index != std::string::npos) {
-        std::string suffix = m_path.substr(index);
-        if (SUFFIX_TYPE.count(suffix) == 1) {
-            return SUFFIX_TYPE.find(suffix)->second;
+        const char* suffix = path.c_str() + index;
+        for (int i = 1; i < MIME_NUMS; i++) {
+            if (strcmp(suffix, MIME_TYPES[i].suffix) == 0)
+                return i;
         }
     }
 
-    return "text/plain";
+    return 0;
+}
+
+int HttpResponse::codeIndex(int code) {
+    for (int i = 0; i < CODE_NUMS; i++) {
+        if (CODE_STATUS[i].code == code)
+            return i;
+    }
+
+    return -1;
 }
 
-void HttpResponse::replaceWithErrorContent(Buffer& buff, std::string msg) const {
-    std::string body = "";
+/**
+ * @brief 状态行与固定头部模板，按 (状态码, MIME类型, keep-alive) 组合在首次使用时一次生成
+ */
+const std::string& HttpResponse::headTemplate(int code, int mime, bool isKeepAlive) {
+    static const std::vector<std::string> templates = [] {
+        std::vector<std::string> heads;
+        heads.reserve(CODE_NUMS * (MIME_NUMS + 1) * 2);
+
+        for (int c = 0; c < CODE_NUMS; c++) {
+            for (int m = 0; m <= MIME_NUMS; m++) {
+                for (int keepAlive = 0; keepAlive < 2; keepAlive++) {
+                    std::string head = "HTTP/1.1 " + std::to_string(CODE_STATUS[c].code) + ' ' + CODE_STATUS[c].status + CRLF;
+
+                    head += "Connection: ";
+                    if (keepAlive) {
+                        head += std::string("Keep-Alive") + CRLF;
+                        head += "Keep-Alive: timeout=" + std::to_string(KEEP_ALIVE_TIMEOUT) + ", max=" + std::to_string(KEEP_ALIVE_MAX) + CRLF;
+                    }else
+                        head += std::string("close") + CRLF;
+
+                    if (m == MIME_MULTIPART)
+                        head += std::string("Content-Type: multipart/byteranges; boundary=") + BYTERANGES_BOUNDARY + CRLF;
+                    else {
+                        head += std::string("Content-Type: ") + MIME_TYPES[m].type + CRLF;
+                        if (MIME_TYPES[m].compressible)
+                            head += std::string("Vary: Accept-Encoding") + CRLF;
+                    }
+
+                    head += std::string("Server: yfdHttpServer") + CRLF;
+                    heads.push_back(std::move(head));
+                }
+            }
+        }
 
-    body += "<html><title>Error</title>";
-    body += "<body bgcolor=\"f3f5f5\">";
-    body += "<p>" + msg + "</p>";
-    body += "<hr><em><strong>HttpServer - yfd</strong></em></body></html>";
+        return heads;
+    }();
 
-    buff.append("Content-length: " + std::to_string(body.size()) + CRLF + CRLF);
-    buff.append(body);
+    return templates[(codeIndex(code) * (MIME_NUMS + 1) + mime) * 2 + isKeepAlive];
 }
 
-char* HttpResponse::mmFile() const {
-    return m_memoryMappingFile;
+/**
+ * @brief 内置错误页(含 Content-length 及空行)，各状态码只生成一次
+ */
+const std::string& HttpResponse::errorContent(int code) {
+    static const auto makeContent = [](const std::string& msg) {
+        std::string body = "";
+
+        body += "<html><title>Error</title>";
+        body += "<body bgcolor=\"f3f5f5\">";
+        body += "<p>" + msg + "</p>";
+        body += "<hr><em><strong>HttpServer - yfd</strong></em></body></html>";
+
+        return "Content-length: " + std::to_string(body.size()) + CRLF + CRLF + body;
+    };
+
+    static const std::string notFound = makeContent("File not found");
+    static const std::string notSatisfiable = makeContent("Requested range not satisfiable");
+    static const std::string badRequest = makeContent("Bad request");
+    static const std::string notAllowed = makeContent("Method not allowed");
+    static const std::string tooLarge = makeContent("Request body too large");
+    static const std::string notImplemented = makeContent("Transfer coding not implemented");
+    static const std::string unavailable = makeContent("Service temporarily unavailable");
+
+    switch (code) {
+        case 400:
+            return badRequest;
+        case 405:
+            return notAllowed;
+        case 413:
+            return tooLarge;
+        case 416:
+            return notSatisfiable;
+        case 501:
+            return notImplemented;
+        case 503:
+            return unavailable;
+        default:
+            return notFound;
+    }
 }
 
-size_t HttpResponse::mmFileSize() const {
-    return m_fileState.st_size;
+/**
+ * @brief Date 头按线程缓存，每秒至多格式化一次
+ */
+void HttpResponse::appendDate(Buffer& buff) {
+    static thread_local time_t cachedSec = 0;
+    static thread_local char cachedDate[64];
+    static thread_local size_t cachedLen = 0;
+
+    time_t now = time(nullptr);
+    if (now != cachedSec) {
+        struct tm gmt;
+        gmtime_r(&now, &gmt);
+
+        cachedLen = strftime(cachedDate, sizeof(cachedDate), "Date: %a, %d %b %Y %H:%M:%S GMT" CRLF, &gmt);
+        cachedSec = now;
+    }
+
+    buff.append(cachedDate, cachedLen);
+}
+
+void HttpResponse::appendNumber(Buffer& buff, size_t num) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), num);
+
+    buff.append(digits, result.ptr - digits);
 }
 
-void HttpResponse::unmapFile() {
-    if (m_memoryMappingFile) {
-        munmap(m_memoryMappingFile, m_fileState.st_size);
-        m_memoryMappingFile = nullptr;
+/**
+ * @brief 条件请求是否命中: If-None-Match 优先，缺省时比较 If-Modified-Since
+ */
+bool HttpResponse::isNotModified() const {
+    if (!m_ifNoneMatch.empty()) {
+        if (m_ifNoneMatch.find('*') != std::string::npos)
+            return true;
+
+        // 逐个比较列表中的ETag，If-None-Match 采用弱比较，忽略 W/ 前缀
+        const std::string& etag = m_file->etag();
+        for (size_t pos = m_ifNoneMatch.find(etag); pos != std::string::npos; pos = m_ifNoneMatch.find(etag, pos + 1)) {
+            size_t end = pos + etag.size();
+            if (end == m_ifNoneMatch.size() || m_ifNoneMatch[end] == ',' || m_ifNoneMatch[end] == ' ')
+                return true;
+        }
+
+        return false;
     }
+
+    if (!m_ifModifiedSince.empty()) {
+        struct tm gmt = { 0 };
+        if (!strptime(m_ifModifiedSince.data(), "%a, %d %b %Y %H:%M:%S GMT", &gmt))
+            return false;
+
+        return m_file->fileState().st_mtim.tv_sec <= timegm(&gmt);
+    }
+
+    return false;
+}
+
+/**
+ * @brief 是否按Range响应: If-Range 与当前版本不符时返回完整文件
+ */
+bool HttpResponse::isRangeApplicable() const {
+    if (m_range.empty())
+        return false;
+
+    if (m_ifRange.empty())
+        return true;
+
+    // If-Range 为ETag时要求强匹配，否则视为日期
+    if (m_ifRange[0] == '"')
+        return m_ifRange == m_file->etag();
+
+    return m_ifRange == m_file->lastModified();
+}
+
+/**
+ * @brief 解析 Range: bytes=a-b, c-, -n
+ *
+ * @param size 文件大小
+ * @return true  可满足，m_ranges 为空时表示忽略该头(语法不支持或区间过多)
+ * @return false 所有区间均不可满足(416)
+ */
+bool HttpResponse::parseRanges(size_t size) {
+    static const char PREFIX[] = "bytes=";
+
+    if (m_range.compare(0, sizeof(PREFIX) - 1, PREFIX) != 0)
+        return true;
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    bool syntaxValid = true;
+    size_t specs = 0;
+
+    size_t pos = sizeof(PREFIX) - 1;
+    while (pos < m_range.size() && syntaxValid) {
+        size_t end = m_range.find(',', pos);
+        if (end == std::string::npos)
+            end = m_range.size();
+
+        std::string spec = m_range.substr(pos, end - pos);
+        spec.erase(std::remove(spec.begin(), spec.end(), ' '), spec.end());
+        pos = end + 1;
+
+        if (spec.empty())
+            continue;
+
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos || spec.find_first_not_of("0123456789-") != std::string::npos || spec.find('-', dash + 1) != std::string::npos) {
+            syntaxValid = false;
+            break;
+        }
+
+        specs++;
+
+        const std::string firstStr = spec.substr(0, dash);
+        const std::string lastStr = spec.substr(dash + 1);
+
+        if (firstStr.size() > 18 || lastStr.size() > 18) {    // 超出size_t表示范围
+            syntaxValid = false;
+            break;
+        }
+
+        if (firstStr.empty()) {
+            // 后缀区间: 最后n字节
+            if (lastStr.empty()) {
+                syntaxValid = false;
+                break;
+            }
+
+            size_t n = std::stoull(lastStr);
+            if (n > 0 && size > 0)
+                ranges.emplace_back(size - std::min(n, size), size - 1);
+            continue;
+        }
+
+        size_t first = std::stoull(firstStr);
+        size_t last = lastStr.empty() ? size - 1 : std::stoull(lastStr);
+
+        if (!lastStr.empty() && last < first) {
+            syntaxValid = false;
+            break;
+        }
+
+        if (first < size)
+            ranges.emplace_back(first, std::min(last, size - 1));
+    }
+
+    // 语法错误的Range头按规范忽略
+    if (!syntaxValid || specs == 0 || specs > MAX_RANGES)
+        return true;
+
+    if (ranges.empty())
+        return false;
+
+    m_ranges = std::move(ranges);
+
+    return true;
+}
+
+void HttpResponse::replaceWithErrorContent(Buffer& buff, int code) const {
+    const std::string& content = errorContent(code);
+    buff.append(content.data(), content.size());
+}
+
+std::shared_ptr<const CachedFile> HttpResponse::file() const {
+    return m_file;
+}
+
+const std::vector<HttpResponse::BodyPart>& HttpResponse::bodyParts() const {
+    return m_bodyParts;
+}
+
+void HttpResponse::releaseFile() {
+    m_file.reset();
 }
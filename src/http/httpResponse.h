@@ -2,52 +2,108 @@
 #define _HTTP_RESPONSE_H
 
 #include <string>
+#include <string_view>
+#include <memory>
 #include <unordered_map>
-#include <sys/mman.h>   // mmap
-#include <fcntl.h>      // open
-#include <unistd.h>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
 
+#include "fileCache.h"
 #include "../buffer/buffer.h"
 #include "../logger/logger.h"
 
 #define CRLF                "\r\n"
 #define KEEP_ALIVE_TIMEOUT  60
 #define KEEP_ALIVE_MAX      16
+#define MAX_RANGES          16      // 超过该数量的Range请求按完整文件响应
+#define BYTERANGES_BOUNDARY "3d6b6a416f9b5yfd"
 
 
 class HttpResponse {
+public:
+    // 响应头之后的响应体片段: 写缓冲区中的一段，或资源文件中的一段
+    struct BodyPart {
+        bool inBuff;
+        size_t offset;  // inBuff 时为写缓冲区可读区内的偏移，否则为文件内偏移
+        size_t len;
+    };
+
 public:
     HttpResponse() = default;
     ~HttpResponse();
 
-    void init(std::string srcDir, std::string path, bool isKeepAlive, int code);
+    void init(std::string_view srcDir, std::string_view path, bool isKeepAlive, int code, bool acceptGzip = false);
+    void setConditional(std::string_view ifNoneMatch, std::string_view ifModifiedSince);
+    void setRange(std::string_view range, std::string_view ifRange);
     void makeResponse(Buffer& buff);
 
-    char* mmFile() const;
-    size_t mmFileSize() const;
-    void unmapFile();
+    std::shared_ptr<const CachedFile> file() const;
+    const std::vector<BodyPart>& bodyParts() const;
+    void releaseFile();
 
 private:
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    static const std::unordered_map<int, std::string> CODE_STATUS;
+    struct MimeType {
+        const char* suffix;
+        const char* type;
+        bool compressible;  // 文本类资源才值得压缩，图片音视频等本身已是压缩格式
+    };
+
+    struct CodeStatus {
+        int code;
+        const char* status;
+    };
+
+    static const MimeType MIME_TYPES[];     // 首项为缺省类型
+    static const int MIME_NUMS;
+    static const int MIME_MULTIPART;        // 多区间206的虚拟类型，排在 MIME_TYPES 之后
+    static const CodeStatus CODE_STATUS[];
+    static const int CODE_NUMS;
     static const std::unordered_map<int, std::string> CODE_ERR_PATH;
 
 private:
     int m_code;
+    int m_mime;         // MIME_TYPES 下标
     std::string m_srcDir;
     std::string m_path;
     bool m_isKeepAlive;
+    bool m_acceptGzip;
+    bool m_gzipped;     // 发送的是gzip副本
 
-    char* m_memoryMappingFile;
-    struct stat m_fileState;
+    // 条件请求
+    std::string m_ifNoneMatch;
+    std::string m_ifModifiedSince;
+
+    // 范围请求，区间为闭区间 [first, second]
+    std::string m_range;
+    std::string m_ifRange;
+    std::vector<std::pair<size_t, size_t>> m_ranges;
+
+    std::shared_ptr<const CachedFile> m_file;   // 与文件缓存共享，连接写完后释放
+    std::vector<BodyPart> m_bodyParts;
 
     void addStatusLine(Buffer& buff);
     void addHeaders(Buffer& buff);
     void addContent(Buffer& buff);
 
-    void replaceWithErrorContent(Buffer& buff, std::string msg) const;
+    void replaceWithErrorContent(Buffer& buff, int code) const;
+
+    static int mimeIndex(const std::string& path);
+    static int codeIndex(int code);
+    static const std::string& headTemplate(int code, int mime, bool isKeepAlive);
+    static const std::string& errorContent(int code);
+    static void appendDate(Buffer& buff);
+    static void appendNumber(Buffer& buff, size_t num);
 
-    const std::string getFileType() const;
+    const char* getFileType() const;
+    bool isCompressible() const;
+    bool isNotModified() const;
+    bool isRangeApplicable() const;
+    bool parseRanges(size_t size);
+    void addRangeContent(Buffer& buff);
 };
 
 #endif  // _HTTP_RESPONSE_H
\ No newline at end of file
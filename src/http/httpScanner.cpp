@@ -0,0 +1,305 @@
+#include "httpScanner.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCANNER_X86 1
+#else
+#define SCANNER_X86 0
+#endif
+
+// 十六进制字符的值，非十六进制字符为 -1
+static const signed char HEX_VALUE[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static inline bool isTokenEnd(unsigned char ch) {
+    return ch <= ' ' || ch == 0x7f;
+}
+
+static inline bool isBadValueChar(unsigned char ch) {
+    return (ch < ' ' && ch != '\t') || ch == 0x7f;
+}
+
+/**
+ * @brief 在 *in == '%' 处解码一个转义，返回消耗的输入字节数
+ */
+static inline size_t decodeEscape(const char* in, const char* end, char* out) {
+    if (end - in >= 3) {
+        int high = HEX_VALUE[static_cast<unsigned char>(in[1])];
+        int low = HEX_VALUE[static_cast<unsigned char>(in[2])];
+
+        if (high >= 0 && low >= 0) {
+            *out = static_cast<char>(high << 4 | low);
+            return 3;
+        }
+    }
+
+    *out = '%';
+    return 1;
+}
+
+// ---------------------------------------------------------------- 标量实现
+
+static const char* scalarFindLineEnd(const char* p, const char* end) {
+    while (p < end && *p != '\r' && *p != '\n') p++;
+    return p;
+}
+
+static const char* scalarFindTokenEnd(const char* p, const char* end) {
+    while (p < end && !isTokenEnd(*p)) p++;
+    return p;
+}
+
+static const char* scalarFindHeaderNameEnd(const char* p, const char* end) {
+    while (p < end && *p != ':' && !isTokenEnd(*p)) p++;
+    return p;
+}
+
+static const char* scalarFindHeaderValueEnd(const char* p, const char* end) {
+    while (p < end && !isBadValueChar(*p)) p++;
+    return p;
+}
+
+// 解码 [in, end) 写至 out(out <= in)，返回写出的末尾
+static char* decodeRange(const char* in, const char* end, char* out) {
+    while (in < end) {
+        if (*in == '%')
+            in += decodeEscape(in, end, out++);
+        else {
+            *out++ = *in == '+' ? ' ' : *in;
+            in++;
+        }
+    }
+
+    return out;
+}
+
+static size_t scalarUrlDecode(char* data, size_t len) {
+    return decodeRange(data, data + len, data) - data;
+}
+
+#if SCANNER_X86
+
+// ---------------------------------------------------------------- SSE2 / AVX2 实现
+// 两套实现结构相同，只是向量宽度与指令不同；AVX2 函数单独以 target 属性编译，运行时确认CPU支持后才会被调用
+
+#define SSE2_MASK_LINE_END(v) \
+    (_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))))
+
+// 无符号 ch <= 0x20 等价于 min(ch, 0x20) == ch
+#define SSE2_MASK_TOKEN_END(v) \
+    (_mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(' ')), v), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f))))
+
+#define SSE2_MASK_NAME_END(v) \
+    (_mm_or_si128(SSE2_MASK_TOKEN_END(v), _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))))
+
+#define SSE2_MASK_BAD_VALUE(v) \
+    (_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v)), \
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f))))
+
+#define AVX2_MASK_LINE_END(v) \
+    (_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))))
+
+#define AVX2_MASK_TOKEN_END(v) \
+    (_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(' ')), v), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f))))
+
+#define AVX2_MASK_NAME_END(v) \
+    (_mm256_or_si256(AVX2_MASK_TOKEN_END(v), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))))
+
+#define AVX2_MASK_BAD_VALUE(v) \
+    (_mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v)), \
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f))))
+
+#define DEFINE_SSE2_SCAN(name, MASK, scalar)                                        \
+    static const char* name(const char* p, const char* end) {                      \
+        for (; end - p >= 16; p += 16) {                                            \
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));       \
+            unsigned mask = _mm_movemask_epi8(MASK(v));                             \
+            if (mask)                                                               \
+                return p + __builtin_ctz(mask);                                     \
+        }                                                                           \
+        return scalar(p, end);                                                      \
+    }
+
+#define DEFINE_AVX2_SCAN(name, MASK, scalar)                                        \
+    __attribute__((target("avx2")))                                                 \
+    static const char* name(const char* p, const char* end) {                      \
+        for (; end - p >= 32; p += 32) {                                            \
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));    \
+            unsigned mask = _mm256_movemask_epi8(MASK(v));                          \
+            if (mask)                                                               \
+                return p + __builtin_ctz(mask);                                     \
+        }                                                                           \
+        return scalar(p, end);                                                      \
+    }
+
+DEFINE_SSE2_SCAN(sse2FindLineEnd, SSE2_MASK_LINE_END, scalarFindLineEnd)
+DEFINE_SSE2_SCAN(sse2FindTokenEnd, SSE2_MASK_TOKEN_END, scalarFindTokenEnd)
+DEFINE_SSE2_SCAN(sse2FindHeaderNameEnd, SSE2_MASK_NAME_END, scalarFindHeaderNameEnd)
+DEFINE_SSE2_SCAN(sse2FindHeaderValueEnd, SSE2_MASK_BAD_VALUE, scalarFindHeaderValueEnd)
+
+DEFINE_AVX2_SCAN(avx2FindLineEnd, AVX2_MASK_LINE_END, scalarFindLineEnd)
+DEFINE_AVX2_SCAN(avx2FindTokenEnd, AVX2_MASK_TOKEN_END, scalarFindTokenEnd)
+DEFINE_AVX2_SCAN(avx2FindHeaderNameEnd, AVX2_MASK_NAME_END, scalarFindHeaderNameEnd)
+DEFINE_AVX2_SCAN(avx2FindHeaderValueEnd, AVX2_MASK_BAD_VALUE, scalarFindHeaderValueEnd)
+
+/*
+    原地解码: 整块不含 '%' 时 '+' 按向量替换后整块写回；
+    写出位置总不超过读取位置，整块写回只覆盖已读入的字节。
+    块内有 '%' 时只写回其前的部分，转义按标量解码
+*/
+static size_t sse2UrlDecode(char* data, size_t len) {
+    const char* in = data;
+    const char* end = data + len;
+    char* out = data;
+
+    while (end - in >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i plus = _mm_cmpeq_epi8(v, _mm_set1_epi8('+'));
+        v = _mm_or_si128(_mm_andnot_si128(plus, v), _mm_and_si128(plus, _mm_set1_epi8(' ')));
+
+        unsigned pct = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('%')));
+        if (!pct) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+            in += 16;
+            out += 16;
+            continue;
+        }
+
+        alignas(16) char block[16];
+        size_t n = __builtin_ctz(pct);
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(block), v);
+        memmove(out, block, n);
+        in += n;
+        out += n;
+        in += decodeEscape(in, end, out++);
+    }
+
+    return decodeRange(in, end, out) - data;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2UrlDecode(char* data, size_t len) {
+    const char* in = data;
+    const char* end = data + len;
+    char* out = data;
+
+    while (end - in >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        __m256i plus = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('+'));
+        v = _mm256_blendv_epi8(v, _mm256_set1_epi8(' '), plus);
+
+        unsigned pct = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('%')));
+        if (!pct) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+            in += 32;
+            out += 32;
+            continue;
+        }
+
+        alignas(32) char block[32];
+        size_t n = __builtin_ctz(pct);
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(block), v);
+        memmove(out, block, n);
+        in += n;
+        out += n;
+        in += decodeEscape(in, end, out++);
+    }
+
+    return decodeRange(in, end, out) - data;
+}
+
+#endif  // SCANNER_X86
+
+HttpScanner::ScanFunc HttpScanner::s_findLineEnd = scalarFindLineEnd;
+HttpScanner::ScanFunc HttpScanner::s_findTokenEnd = scalarFindTokenEnd;
+HttpScanner::ScanFunc HttpScanner::s_findHeaderNameEnd = scalarFindHeaderNameEnd;
+HttpScanner::ScanFunc HttpScanner::s_findHeaderValueEnd = scalarFindHeaderValueEnd;
+HttpScanner::DecodeFunc HttpScanner::s_urlDecode = scalarUrlDecode;
+const char* HttpScanner::s_isa = "scalar";
+
+bool HttpScanner::s_dispatched = HttpScanner::dispatch();
+
+/**
+ * @brief 按CPU特性选择实现，静态初始化时执行一次
+ */
+bool HttpScanner::dispatch() {
+#if SCANNER_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        s_findLineEnd = avx2FindLineEnd;
+        s_findTokenEnd = avx2FindTokenEnd;
+        s_findHeaderNameEnd = avx2FindHeaderNameEnd;
+        s_findHeaderValueEnd = avx2FindHeaderValueEnd;
+        s_urlDecode = avx2UrlDecode;
+        s_isa = "avx2";
+    }
+    else {
+        // SSE2 是 x86_64 的基础指令集
+        s_findLineEnd = sse2FindLineEnd;
+        s_findTokenEnd = sse2FindTokenEnd;
+        s_findHeaderNameEnd = sse2FindHeaderNameEnd;
+        s_findHeaderValueEnd = sse2FindHeaderValueEnd;
+        s_urlDecode = sse2UrlDecode;
+        s_isa = "sse2";
+    }
+#endif
+
+    return true;
+}
+
+void HttpScanner::setSimdEnabled(bool enabled) {
+    if (enabled) {
+        dispatch();
+        return;
+    }
+
+    s_findLineEnd = scalarFindLineEnd;
+    s_findTokenEnd = scalarFindTokenEnd;
+    s_findHeaderNameEnd = scalarFindHeaderNameEnd;
+    s_findHeaderValueEnd = scalarFindHeaderValueEnd;
+    s_urlDecode = scalarUrlDecode;
+    s_isa = "scalar";
+}
+
+const char* HttpScanner::isa() {
+    return s_isa;
+}
+
+const char* HttpScanner::findLineEnd(const char* p, const char* end) {
+    return s_findLineEnd(p, end);
+}
+
+const char* HttpScanner::findTokenEnd(const char* p, const char* end) {
+    return s_findTokenEnd(p, end);
+}
+
+const char* HttpScanner::findHeaderNameEnd(const char* p, const char* end) {
+    return s_findHeaderNameEnd(p, end);
+}
+
+const char* HttpScanner::findHeaderValueEnd(const char* p, const char* end) {
+    return s_findHeaderValueEnd(p, end);
+}
+
+size_t HttpScanner::urlDecode(char* data, size_t len) {
+    return s_urlDecode(data, len);
+}
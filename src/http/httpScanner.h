@@ -0,0 +1,62 @@
+/*
+    请求解析用到的字节扫描
+    x86_64 上按 AVX2 / SSE2 / 标量 的顺序在运行时择优，每次处理32/16字节
+*/
+
+#ifndef _HTTP_SCANNER_H
+#define _HTTP_SCANNER_H
+
+#include <cstddef>
+#include <cstring>
+
+class HttpScanner {
+public:
+    /**
+     * @brief 第一个 \r 或 \n
+     */
+    static const char* findLineEnd(const char* p, const char* end);
+
+    /**
+     * @brief 第一个空白、控制字符或DEL，用于请求目标等以空格分隔的词法单元
+     */
+    static const char* findTokenEnd(const char* p, const char* end);
+
+    /**
+     * @brief 请求头名称的结束处: 第一个 ':'、空白、控制字符或DEL
+     */
+    static const char* findHeaderNameEnd(const char* p, const char* end);
+
+    /**
+     * @brief 请求头值中第一个非法字节(HTAB以外的控制字符、DEL)，合法的值止于行尾的 \r 或 \n
+     */
+    static const char* findHeaderValueEnd(const char* p, const char* end);
+
+    /**
+     * @brief 原地解码 application/x-www-form-urlencoded: %XX 与 '+'，不完整或非法的转义原样保留
+     *
+     * @return 解码后的长度
+     */
+    static size_t urlDecode(char* data, size_t len);
+
+    // 当前选用的实现: "avx2" "sse2" "scalar"
+    static const char* isa();
+
+    // 关闭时退回标量实现，用于对比测试
+    static void setSimdEnabled(bool enabled);
+
+private:
+    using ScanFunc = const char* (*)(const char*, const char*);
+    using DecodeFunc = size_t (*)(char*, size_t);
+
+    static ScanFunc s_findLineEnd;
+    static ScanFunc s_findTokenEnd;
+    static ScanFunc s_findHeaderNameEnd;
+    static ScanFunc s_findHeaderValueEnd;
+    static DecodeFunc s_urlDecode;
+    static const char* s_isa;
+
+    static bool dispatch();
+    static bool s_dispatched;
+};
+
+#endif  // _HTTP_SCANNER_H
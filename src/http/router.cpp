@@ -0,0 +1,262 @@
+#include "router.h"
+
+#include <algorithm>
+#include <cassert>
+
+Router Router::s_router;
+
+Router::Router() {
+    clear();
+}
+
+Router* Router::Instance() {
+    return &s_router;
+}
+
+/**
+ * @brief 设置默认静态目录，处理函数给出的页面均位于其下
+ */
+void Router::init(const std::string& defaultDir) {
+    m_defaultDir = defaultDir;
+}
+
+/**
+ * @brief 精确路由
+ *
+ * @param blocking 处理函数会阻塞(如访问数据库)，由调用方交给专用线程执行
+ */
+void Router::addRoute(std::string_view method, std::string_view path, Handler handler, bool blocking) {
+    int idx = insert(path);
+    setHandler(m_nodes[idx].exact, method, std::move(handler), blocking);
+}
+
+/**
+ * @brief 前缀路由，只在路径分隔处匹配: "/api" 匹配 "/api" 与 "/api/x"，不匹配 "/apix"
+ */
+void Router::addPrefixRoute(std::string_view method, std::string_view prefix, Handler handler, bool blocking) {
+    int idx = insert(prefix);
+    setHandler(m_nodes[idx].prefix, method, std::move(handler), blocking);
+}
+
+/**
+ * @brief GET path 时响应默认静态目录下的 page
+ */
+void Router::addPage(std::string_view path, std::string_view page) {
+    addRoute("GET", path, [page = std::string(page)](const HttpRequest&, std::string& target) {
+        target.assign(page);
+        return 200;
+    });
+}
+
+/**
+ * @brief 静态目录挂载: GET / HEAD prefix 下的路径映射为 dir 下的文件
+ */
+void Router::mount(std::string_view prefix, const std::string& dir) {
+    int idx = insert(prefix);
+
+    if (m_nodes[idx].mount < 0) {
+        m_nodes[idx].mount = m_mounts.size();
+        m_mounts.push_back(dir);
+    }
+    else
+        m_mounts[m_nodes[idx].mount] = dir;
+}
+
+void Router::clear() {
+    m_nodes.clear();
+    m_nodes.push_back({ "", {}, {}, {}, -1 });
+    m_mounts.clear();
+}
+
+/**
+ * @brief 路由一个请求: 精确路由优先，其次由深至浅尝试各前缀路由与静态挂载
+ *
+ * 查询串不参与路由；静态路径中含 "/.." 时视为不存在，不允许越出挂载目录
+ * 命中阻塞的处理函数时只记入 target.deferred，不执行
+ */
+void Router::dispatch(const HttpRequest& request, Target& target) const {
+    static const size_t MAX_CANDIDATES = 16;
+
+    std::string_view method = request.method();
+    std::string_view path = request.path();
+    path = path.substr(0, path.find('?'));
+
+    target.code = 404;
+    target.dir = m_defaultDir;
+    target.path = path;
+    target.deferred = nullptr;
+
+    // 沿路径下行，记录途经的可用前缀节点
+    const Node* candidates[MAX_CANDIDATES];
+    size_t prefixLens[MAX_CANDIDATES];
+    size_t candidateNums = 0;
+
+    const Node* node = &m_nodes[0];
+    size_t pos = 0;
+
+    while (node) {
+        bool atBoundary = pos == path.size() || path[pos] == '/' || (pos > 0 && path[pos - 1] == '/');
+        if (atBoundary && (!node->prefix.empty() || node->mount >= 0)) {
+            size_t slot = std::min(candidateNums, MAX_CANDIDATES - 1);
+            candidates[slot] = node;
+            prefixLens[slot] = pos;
+            candidateNums = slot + 1;
+        }
+
+        if (pos == path.size())
+            break;
+
+        const Node* next = nullptr;
+        for (int child : node->children) {
+            if (m_nodes[child].label[0] == path[pos]) {
+                next = &m_nodes[child];
+                break;
+            }
+        }
+
+        if (next && path.compare(pos, next->label.size(), next->label) == 0)
+            pos += next->label.size();
+        else
+            next = nullptr;
+
+        node = next;
+    }
+
+    bool methodMismatch = false;
+
+    if (node && !node->exact.empty()) {
+        if (const MethodHandler* mh = findHandler(node->exact, method)) {
+            route(*mh, request, target);
+            return;
+        }
+        methodMismatch = true;
+    }
+
+    for (size_t i = candidateNums; i-- > 0;) {
+        const Node* candidate = candidates[i];
+
+        if (const MethodHandler* mh = findHandler(candidate->prefix, method)) {
+            route(*mh, request, target);
+            return;
+        }
+
+        if (candidate->mount < 0)
+            continue;
+
+        if (method != "GET" && method != "HEAD") {
+            methodMismatch = true;
+            continue;
+        }
+
+        // 去掉挂载前缀，保留开头的 '/'
+        size_t len = prefixLens[i];
+        std::string_view rest = path.substr(len > 0 && path[len - 1] == '/' ? len - 1 : len);
+
+        target.dir = m_mounts[candidate->mount];
+        target.path = rest;
+        target.code = rest.find("/..") == std::string_view::npos ? 200 : 404;
+        return;
+    }
+
+    if (methodMismatch)
+        target.code = 405;
+}
+
+/**
+ * @brief 执行 dispatch 留下的阻塞处理函数，可在任意线程调用
+ */
+void Router::runDeferred(const HttpRequest& request, Target& target) const {
+    assert(target.deferred);
+
+    const Handler* handler = target.deferred;
+    target.deferred = nullptr;
+
+    target.page.clear();
+    int code = (*handler)(request, target.page);
+
+    target.code = code == 200 && target.page.empty() ? 404 : code;
+    target.dir = m_defaultDir;
+    target.path = target.page;
+}
+
+/**
+ * @brief 命中处理函数: 非阻塞的就地执行，阻塞的留待 runDeferred
+ */
+void Router::route(const MethodHandler& mh, const HttpRequest& request, Target& target) const {
+    target.deferred = &mh.handler;
+
+    if (!mh.blocking)
+        runDeferred(request, target);
+}
+
+/**
+ * @brief 插入路径，必要时分裂已有的边，返回路径结束处的节点
+ */
+int Router::insert(std::string_view path) {
+    int cur = 0;
+    size_t pos = 0;
+
+    while (pos < path.size()) {
+        int next = -1;
+        for (int child : m_nodes[cur].children) {
+            if (m_nodes[child].label[0] == path[pos]) {
+                next = child;
+                break;
+            }
+        }
+
+        if (next < 0) {
+            m_nodes.push_back({ std::string(path.substr(pos)), {}, {}, {}, -1 });
+            m_nodes[cur].children.push_back(m_nodes.size() - 1);
+            return m_nodes.size() - 1;
+        }
+
+        const std::string& label = m_nodes[next].label;
+        size_t common = 0;
+        while (common < label.size() && pos + common < path.size() && label[common] == path[pos + common])
+            common++;
+
+        // 只有部分相同: 在分歧处分裂出中间节点
+        if (common < label.size()) {
+            Node mid = { label.substr(0, common), { next }, {}, {}, -1 };
+            m_nodes[next].label.erase(0, common);
+            m_nodes.push_back(std::move(mid));
+
+            int midIdx = m_nodes.size() - 1;
+            std::replace(m_nodes[cur].children.begin(), m_nodes[cur].children.end(), next, midIdx);
+            next = midIdx;
+        }
+
+        cur = next;
+        pos += common;
+    }
+
+    return cur;
+}
+
+/**
+ * @brief 查找方法对应的处理函数，未单独注册 HEAD 时使用 GET 的处理函数
+ */
+const Router::MethodHandler* Router::findHandler(const std::vector<MethodHandler>& handlers, std::string_view method) {
+    for (const MethodHandler& mh : handlers) {
+        if (mh.method == method)
+            return &mh;
+    }
+
+    if (method == "HEAD")
+        return findHandler(handlers, "GET");
+
+    return nullptr;
+}
+
+void Router::setHandler(std::vector<MethodHandler>& handlers, std::string_view method, Handler handler, bool blocking) {
+    for (MethodHandler& mh : handlers) {
+        if (mh.method == method) {
+            mh.handler = std::move(handler);
+            mh.blocking = blocking;
+            return;
+        }
+    }
+
+    handlers.push_back({ std::string(method), std::move(handler), blocking });
+}
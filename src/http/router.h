@@ -0,0 +1,85 @@
+/*
+    路由表
+    按 方法 + 路径 注册处理函数，另支持前缀路由与静态目录挂载
+    路径存放于压缩前缀树(radix tree)，一次查找只沿请求路径走一遍，与路由数量无关
+    路由在服务启动前注册，运行期间只读，无需加锁
+    阻塞的处理函数(如访问数据库)不在查找时执行，由调用方交给专用线程后经 runDeferred 执行
+*/
+
+#ifndef _ROUTER_H
+#define _ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+#include "httpRequest.h"
+
+class Router {
+public:
+    /**
+     * @brief 动态处理函数
+     *
+     * @param request 已解析完成的请求
+     * @param page    响应的页面，为默认静态目录下的路径；置空时响应404
+     * @return 状态码，非200时忽略 page，响应对应的错误页(如依赖不可用时的503)
+     */
+    using Handler = std::function<int(const HttpRequest& request, std::string& page)>;
+
+    // 路由结果
+    struct Target {
+        int code;               // 200 / 404 / 405，或处理函数给出的状态码
+        std::string_view dir;   // 资源根目录
+        std::string_view path;  // 根目录下的资源路径
+        std::string page;       // 处理函数给出的页面，path 指向它；连接间复用以免重复分配
+        const Handler* deferred;    // 待执行的阻塞处理函数，为空时其余字段即为结果
+    };
+
+public:
+    Router();
+    ~Router() = default;
+
+    static Router* Instance();
+
+public:
+    void init(const std::string& defaultDir);
+
+    void addRoute(std::string_view method, std::string_view path, Handler handler, bool blocking = false);
+    void addPrefixRoute(std::string_view method, std::string_view prefix, Handler handler, bool blocking = false);
+    void addPage(std::string_view path, std::string_view page);
+    void mount(std::string_view prefix, const std::string& dir);
+    void clear();
+
+    void dispatch(const HttpRequest& request, Target& target) const;
+    void runDeferred(const HttpRequest& request, Target& target) const;
+
+private:
+    struct MethodHandler {
+        std::string method;
+        Handler handler;
+        bool blocking;
+    };
+
+    struct Node {
+        std::string label;                  // 父节点到本节点的边
+        std::vector<int> children;          // 各子节点边的首字符互不相同
+        std::vector<MethodHandler> exact;   // 路径恰好在此结束时的处理函数
+        std::vector<MethodHandler> prefix;  // 以此为前缀的路径的处理函数
+        int mount;                          // 以此为前缀的静态目录，m_mounts 下标，-1 为无
+    };
+
+    std::vector<Node> m_nodes;          // m_nodes[0] 为根
+    std::vector<std::string> m_mounts;
+    std::string m_defaultDir;
+
+    static Router s_router;
+
+private:
+    int insert(std::string_view path);
+    void route(const MethodHandler& mh, const HttpRequest& request, Target& target) const;
+    static const MethodHandler* findHandler(const std::vector<MethodHandler>& handlers, std::string_view method);
+    static void setHandler(std::vector<MethodHandler>& handlers, std::string_view method, Handler handler, bool blocking);
+};
+
+#endif  // _ROUTER_H
@@ -1,11 +1,16 @@
 #include "server/server.h"
 
 int main() {
-    BaseConfig baseConfig = { 7777, 3, 60000, 1 };
+    BaseConfig baseConfig = { 7777, 3, 60000, 1, 0, _EPOLL };
     SQLConfig sqlConfig = { 3306, "127.0.0.1", "root", "123", "http" };
+#ifdef WITH_MYSQL
+    AuthConfig authConfig = { _AUTH_MYSQL, "./auth.db", 64 };
+#else
+    AuthConfig authConfig = { _AUTH_SQLITE, "./auth.db", 64 };
+#endif
     LoggerConfig loggerConfig = { _INFO, _BOTH, "./log", ".log" };
 
-    Server httpServer(&baseConfig, &sqlConfig, &loggerConfig, 8, 16, 1024);
+    Server httpServer(&baseConfig, &sqlConfig, &authConfig, &loggerConfig, 8, 16, 1024);
 
     httpServer.run();
 
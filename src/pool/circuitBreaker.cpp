@@ -0,0 +1,111 @@
+#include "circuitBreaker.h"
+#include "../logger/logger.h"
+
+CircuitBreaker::CircuitBreaker() {
+    close(Clock::now());
+}
+
+/**
+ * @brief 调用前询问是否放行，放行的调用须以 record 报告结果
+ *
+ * @param trial 放行的是否为半开时的试探调用，原样交给 record
+ * @return false 拒绝，调用方应直接失败
+ */
+bool CircuitBreaker::allow(bool& trial) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    trial = false;
+
+    if (m_state == _BREAKER_CLOSED)
+        return true;
+
+    if (m_state == _BREAKER_OPEN) {
+        if (Clock::now() < m_openUntil)
+            return false;
+
+        m_state = _BREAKER_HALF_OPEN;
+        m_trialsInFlight = 0;
+        m_trialsPassed = 0;
+    }
+
+    if (m_trialsInFlight + m_trialsPassed >= BREAKER_HALF_OPEN_TRIALS)
+        return false;
+
+    m_trialsInFlight++;
+    trial = true;
+    return true;
+}
+
+/**
+ * @brief 报告放行的调用的结果；断开前放行、断开后才结束的调用不再计入
+ *
+ * @param ok      调用成功
+ * @param elapsed 调用耗时，超过 BREAKER_SLOW_MS 时计为失败
+ */
+void CircuitBreaker::record(bool trial, bool ok, Clock::duration elapsed) {
+    const Clock::time_point now = Clock::now();
+    const bool failed = !ok || elapsed >= std::chrono::milliseconds(BREAKER_SLOW_MS);
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+
+    if (trial) {
+        if (m_state != _BREAKER_HALF_OPEN)
+            return;
+
+        m_trialsInFlight--;
+
+        if (failed)
+            open(now);
+        else if (++m_trialsPassed >= BREAKER_HALF_OPEN_TRIALS) {
+            close(now);
+            Logger::Instance()->LOG_INFO("circuit breaker closed");
+        }
+        return;
+    }
+
+    if (m_state != _BREAKER_CLOSED)
+        return;
+
+    if (now - m_windowStart >= std::chrono::seconds(BREAKER_WINDOW_S)) {
+        m_windowStart = now;
+        m_calls = 0;
+        m_failures = 0;
+    }
+
+    m_calls++;
+
+    if (!failed) {
+        m_consecutive = 0;
+        return;
+    }
+
+    m_failures++;
+    m_consecutive++;
+
+    if (m_consecutive >= BREAKER_CONSECUTIVE_FAILURES ||
+        (m_calls >= BREAKER_MIN_CALLS && m_failures * 100 >= m_calls * BREAKER_FAILURE_PERCENT))
+        open(now);
+}
+
+BREAKER_STATE CircuitBreaker::state() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_state;
+}
+
+void CircuitBreaker::open(Clock::time_point now) {
+    m_state = _BREAKER_OPEN;
+    m_openUntil = now + std::chrono::seconds(BREAKER_OPEN_S);
+
+    std::string msg = "circuit breaker open for " + std::to_string(BREAKER_OPEN_S) + "s, window failures: "
+        + std::to_string(m_failures) + " / " + std::to_string(m_calls);
+    Logger::Instance()->LOG_WARNING(msg);
+}
+
+void CircuitBreaker::close(Clock::time_point now) {
+    m_state = _BREAKER_CLOSED;
+    m_windowStart = now;
+    m_calls = 0;
+    m_failures = 0;
+    m_consecutive = 0;
+    m_trialsInFlight = 0;
+    m_trialsPassed = 0;
+}
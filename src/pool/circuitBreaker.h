@@ -0,0 +1,60 @@
+/*
+    熔断器: 依赖(数据库)持续出错或过慢时断开，期间请求直接失败，不再占用线程等待
+    关闭: 正常放行，统计窗口内失败率或连续失败数超过阈值时断开
+    断开: 全部拒绝，BREAKER_OPEN_S 后转为半开
+    半开: 放行少量试探请求，全部成功则关闭，任一失败则重新断开
+*/
+
+#ifndef _CIRCUIT_BREAKER_H
+#define _CIRCUIT_BREAKER_H
+
+#include <mutex>
+#include <chrono>
+
+#define BREAKER_WINDOW_S                10      // 失败率统计窗口
+#define BREAKER_MIN_CALLS               20      // 窗口内调用数达到该值才按失败率判定
+#define BREAKER_FAILURE_PERCENT         50      // 窗口内失败率阈值
+#define BREAKER_CONSECUTIVE_FAILURES    5       // 连续失败数阈值，调用稀少时也能及时断开
+#define BREAKER_SLOW_MS                 1000    // 耗时超过该值的调用计为失败
+#define BREAKER_OPEN_S                  5       // 断开时长
+#define BREAKER_HALF_OPEN_TRIALS        3       // 半开时的试探请求数
+
+enum BREAKER_STATE {
+    _BREAKER_CLOSED,
+    _BREAKER_OPEN,
+    _BREAKER_HALF_OPEN
+};
+
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CircuitBreaker();
+    ~CircuitBreaker() = default;
+
+public:
+    bool allow(bool& trial);
+    void record(bool trial, bool ok, Clock::duration elapsed);
+    BREAKER_STATE state();
+
+private:
+    BREAKER_STATE m_state;
+    Clock::time_point m_openUntil;
+
+    // 关闭状态的统计
+    Clock::time_point m_windowStart;
+    int m_calls;
+    int m_failures;
+    int m_consecutive;
+
+    // 半开状态的试探
+    int m_trialsInFlight;
+    int m_trialsPassed;
+
+    std::mutex m_mutex;
+
+    void open(Clock::time_point now);
+    void close(Clock::time_point now);
+};
+
+#endif  // _CIRCUIT_BREAKER_H
@@ -1,39 +1,58 @@
 #include "sqlConnPool.h"
 
+#include <algorithm>
+
 SqlConnPool SqlConnPool::s_sqlConnPool;
 
+// 与 SQL_STMT 一一对应
+const char* const SqlConnPool::SQL_STMT_TEXT[] = {
+    "SELECT password FROM login WHERE username = ? LIMIT 1",
+    "INSERT INTO login(username, password) VALUES(?, ?)",
+};
+
 /**
- * @brief 数据库连接池初始化
+ * @brief 数据库连接池初始化，下限数量的连接在后台并行建立，不阻塞服务启动
+ *
+ * 建立中的连接已计入连接数，期间取连接的请求只需等到第一个连接就绪；
+ * 建立失败的连接释放名额，由后台维护线程补足
  * 
- * @param conn_nums 预备的连接数量
+ * @param minConns 连接数下限，空闲连接不会收缩到其以下
+ * @param maxConns 连接数上限，等待空闲连接过久时在此范围内新建
  * @param info 数据库相关信息
  */
-void SqlConnPool::init(int conn_nums, SqlConnInfo* info) {
-    assert(conn_nums > 0);
+void SqlConnPool::init(int minConns, int maxConns, SqlConnInfo* info) {
+    assert(minConns > 0 && maxConns >= minConns);
 
-    for (int i = 0; i < conn_nums; i++) {
-        MYSQL* conn = nullptr;
-        conn = mysql_init(conn);
+    m_port = info->port;
+    m_host = info->host;
+    m_user = info->user;
+    m_pwd = info->pwd;
+    m_dbName = info->db_name;
+    m_connectTimeout = info->connect_timeout;
+    m_readTimeout = info->read_timeout;
+    m_writeTimeout = info->write_timeout;
 
-        if(!conn) {
-            Logger::Instance()->LOG_ERROR("数据库连接实例启动失败 - 1");
-            exit(-2);
-        }
-        conn = mysql_real_connect(conn, info->host, info->user, info->pwd, info->db_name, info->port, nullptr, 0);
+    m_minConns = minConns;
+    m_maxConns = maxConns;
 
-        if (!conn) {
-            Logger::Instance()->LOG_ERROR("数据库连接实例启动失败 - 2");
-            exit(-2);
-        }
+    // mysql_init 首次调用时隐式初始化客户端库，非线程安全，须在并行建立连接前完成
+    mysql_library_init(0, nullptr, nullptr);
 
-        m_conn_pool.push(conn);
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_closed = false;
+        m_conn_nums = minConns;     // 建立中视为使用中，完成后经 freeConn 放回
+        m_used_count = minConns;
+        m_warming = minConns;
     }
-    
-    m_conn_nums = conn_nums;
-    m_freed_count = conn_nums;
-    sem_init(&m_sem, 0, m_conn_nums);
-    
-    Logger::Instance()->LOG_INFO("数据库连接池启动成功");
+
+    for (int i = 0; i < minConns; i++)
+        m_warmers.emplace_back(&SqlConnPool::warmup, this);
+
+    m_maintainer = std::thread(&SqlConnPool::maintain, this);
+
+    std::string msg = "数据库连接池启动，后台建立连接: " + std::to_string(minConns);
+    Logger::Instance()->LOG_INFO(msg);
 }
 
 SqlConnPool::~SqlConnPool() {
@@ -46,60 +65,389 @@ SqlConnPool* SqlConnPool::Instance() {
 
 /**
  * @brief 从连接池获取连接
+ *
+ * 无空闲连接时等待；等待超过 SQL_GROW_WAIT_MS 且未达上限时请后台线程新建连接(启动建立连接期间除外)，
+ * 本线程不建立连接，至多等到 timeoutMS，数据库建连缓慢时调用方也不会堆积
  * 
- * @return MYSQL* object
+ * @param timeoutMS 等待上限
+ * @return MYSQL* object，失败为 nullptr
  */
-MYSQL* SqlConnPool::getConn() {
-    MYSQL* conn = nullptr;
+MYSQL* SqlConnPool::getConn(int timeoutMS) {
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::milliseconds(timeoutMS);
+    const Clock::time_point growAt = start + std::chrono::milliseconds(SQL_GROW_WAIT_MS);
 
-    // if (m_conn_pool.empty()) {
-    //     // LOG_WARNNING()
-    //     return nullptr;
-    // }
+    std::unique_lock<std::mutex> locker(m_mutex);
+    m_waiting++;
 
-    sem_wait(&m_sem);
+    while (m_conn_pool.empty()) {
+        if (m_closed) {
+            m_waiting--;
+            return nullptr;
+        }
 
-    {
-        std::lock_guard<std::mutex> locker(m_mutex);
-        conn = m_conn_pool.front();
-        m_conn_pool.pop();
+        Clock::time_point now = Clock::now();
 
-        m_freed_count--;
-        m_used_count++;
+        if (now >= deadline) {
+            m_waiting--;
+            m_timeout_count++;
+
+            std::string msg = "sql connection acquire timeout, in use: " + std::to_string(m_used_count) + " / " + std::to_string(m_conn_nums);
+            Logger::Instance()->LOG_WARNING(msg);
+            return nullptr;
+        }
+
+        // 启动时的连接尚在建立期间不另建
+        if (m_warming == 0 && !m_growPending && m_conn_nums < m_maxConns && now >= growAt) {
+            m_growPending = true;
+            m_stopCond.notify_one();
+        }
+
+        m_cond.wait_until(locker, now < growAt ? std::min(growAt, deadline) : deadline);
     }
 
+    m_waiting--;
+
+    // 取最近归还的连接，空闲最久的留在队首等待收缩
+    MYSQL* conn = m_conn_pool.back().conn;
+    m_conn_pool.pop_back();
+    m_used_count++;
+
     return conn;
 }
 
 /**
  * @brief 连接释放
  * 
- * @param conn object
+ * @param conn   object，为 nullptr 时只释放其占用的名额
+ * @param broken 连接已失效，直接关闭不放回，由 getConn 按需新建或后台线程补足下限，
+ *               归还者不承担重连的耗时
  */
-void SqlConnPool::freeConn(MYSQL* conn) {
-    std::lock_guard<std::mutex> locker(m_mutex);
-    m_conn_pool.push(conn);
-    
+void SqlConnPool::freeConn(MYSQL* conn, bool broken) {
+    std::unique_lock<std::mutex> locker(m_mutex);
     m_used_count--;
-    m_freed_count++;
 
-    sem_post(&m_sem);
+    if (conn && !broken && !m_closed) {
+        m_conn_pool.push_back({ conn, Clock::now() });
+        m_cond.notify_one();
+        return;
+    }
+
+    // 名额空出后等待者可以新建连接
+    m_conn_nums--;
+    m_cond.notify_one();
+    locker.unlock();
+
+    if (conn) {
+        disconnect(conn);   // 连接已失效或连接池已销毁
+
+        if (broken)
+            Logger::Instance()->LOG_WARNING("sql connection dropped");
+    }
 }
 
 /**
- * @brief 销毁连接池
+ * @brief 连接数量(含使用中)，未初始化时为0
  */
-void SqlConnPool::destoryPool() {
+int SqlConnPool::getConnNums() {
     std::lock_guard<std::mutex> locker(m_mutex);
+    return m_conn_nums;
+}
+
+/**
+ * @brief 连接上已预编译的语句
+ *
+ * @param conn 由 getConn 取得的连接
+ * @return nullptr 预编译失败
+ */
+MYSQL_STMT* SqlConnPool::getStmt(MYSQL* conn, SQL_STMT id) {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    auto it = m_stmts.find(conn);
+    assert(it != m_stmts.end());
+    locker.unlock();
+
+    MYSQL_STMT*& stmt = it->second[id];     // 节点地址不随增删其他连接改变
+    if (!stmt)
+        stmt = prepare(conn, id);
+
+    return stmt;
+}
+
+/**
+ * @brief 以字符串参数执行预编译语句，参数不经拼接，无需转义
+ *
+ * @return false 执行失败，已记录日志
+ */
+bool SqlConnPool::execute(MYSQL_STMT* stmt, std::initializer_list<std::string_view> params) {
+    assert(params.size() <= SQL_MAX_PARAMS);
+
+    MYSQL_BIND binds[SQL_MAX_PARAMS] = {};
+    unsigned long lengths[SQL_MAX_PARAMS];
+    size_t i = 0;
+
+    for (std::string_view param : params) {
+        lengths[i] = param.size();
+
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = const_cast<char*>(param.data());
+        binds[i].buffer_length = param.size();
+        binds[i].length = &lengths[i];
+        i++;
+    }
+
+    if (mysql_stmt_bind_param(stmt, binds) || mysql_stmt_execute(stmt)) {
+        std::string msg = "sql statement execute error: " + std::string(mysql_stmt_error(stmt));
+        Logger::Instance()->LOG_ERROR(msg);
+        return false;
+    }
+
+    return true;
+}
+
+MYSQL_STMT* SqlConnPool::prepare(MYSQL* conn, SQL_STMT id) {
+    MYSQL_STMT* stmt = mysql_stmt_init(conn);
+    const char* sql = SQL_STMT_TEXT[id];
+
+    if (stmt && mysql_stmt_prepare(stmt, sql, strlen(sql)) == 0)
+        return stmt;
+
+    std::string msg = "sql statement prepare error: " + std::string(stmt ? mysql_stmt_error(stmt) : mysql_error(conn)) + " - " + sql;
+    Logger::Instance()->LOG_ERROR(msg);
+
+    if (stmt)
+        mysql_stmt_close(stmt);
+
+    return nullptr;
+}
+
+/**
+ * @brief 建立连接并预编译语句，预编译失败(如表尚未创建)时留空，首次使用时重试
+ *
+ * @return nullptr 连接失败
+ */
+MYSQL* SqlConnPool::connect() {
+    MYSQL* conn = mysql_init(nullptr);
+
+    if (!conn) {
+        Logger::Instance()->LOG_ERROR("数据库连接实例启动失败 - 1");
+        return nullptr;
+    }
+
+    mysql_options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &m_connectTimeout);
+    mysql_options(conn, MYSQL_OPT_READ_TIMEOUT, &m_readTimeout);
+    mysql_options(conn, MYSQL_OPT_WRITE_TIMEOUT, &m_writeTimeout);
+
+    if (!mysql_real_connect(conn, m_host.c_str(), m_user.c_str(), m_pwd.c_str(), m_dbName.c_str(), m_port, nullptr, 0)) {
+        std::string msg = "数据库连接实例启动失败 - 2: " + std::string(mysql_error(conn));
+        Logger::Instance()->LOG_ERROR(msg);
+
+        mysql_close(conn);
+        return nullptr;
+    }
+
+    std::array<MYSQL_STMT*, _SQL_STMT_NUMS> stmts;
+    for (int id = 0; id < _SQL_STMT_NUMS; id++)
+        stmts[id] = prepare(conn, static_cast<SQL_STMT>(id));
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_stmts[conn] = stmts;
+
+    return conn;
+}
+
+/**
+ * @brief 关闭连接及其上的预编译语句，调用时不持锁
+ */
+void SqlConnPool::disconnect(MYSQL* conn) {
+    std::array<MYSQL_STMT*, _SQL_STMT_NUMS> stmts = {};
+
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        auto it = m_stmts.find(conn);
 
-    MYSQL* to_freed_conn = nullptr;
+        if (it != m_stmts.end()) {
+            stmts = it->second;
+            m_stmts.erase(it);
+        }
+    }
 
-    while (!m_conn_pool.empty()) {
-        to_freed_conn = m_conn_pool.front();
-        mysql_close(to_freed_conn);
+    for (MYSQL_STMT* stmt : stmts) {
+        if (stmt)
+            mysql_stmt_close(stmt);
+    }
+
+    mysql_close(conn);
+}
 
-        m_conn_pool.pop();
+/**
+ * @brief 启动时建立一个连接；全部建立完成(含失败)后唤醒所有等待者重新判断
+ */
+void SqlConnPool::warmup() {
+    freeConn(connect());
+
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_warming--;
     }
 
+    m_cond.notify_all();
+}
+
+/**
+ * @brief 后台维护:
+ *        getConn 请求时逐个新建连接，直至无人等待或达到上限；新建失败时暂停到下一轮，不反复冲击数据库
+ *        每秒一轮: 关闭空闲超过 SQL_IDLE_TIMEOUT_S 的多余连接；
+ *        ping 空闲超过 SQL_PING_INTERVAL_S 的连接，失效的关闭；
+ *        连接数因失效关闭低于下限时补足
+ */
+void SqlConnPool::maintain() {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    Clock::time_point nextRound = Clock::now() + std::chrono::seconds(1);
+    bool growPaused = false;
+
+    while (!m_closed) {
+        m_stopCond.wait_until(locker, nextRound, [this, &growPaused] { return m_closed || (m_growPending && !growPaused); });
+        if (m_closed)
+            break;
+
+        if (m_growPending && !growPaused) {
+            m_growPending = false;
+
+            if (m_waiting > 0 && m_conn_pool.empty() && m_conn_nums < m_maxConns) {
+                m_conn_nums++;      // 先占位，建立连接期间不持锁
+                m_used_count++;
+                locker.unlock();
+
+                MYSQL* conn = connect();
+                freeConn(conn);     // 放入空闲队列并唤醒等待者；失败时只释放名额
+
+                locker.lock();
+
+                if (!conn)
+                    growPaused = true;
+                else if (m_waiting > 0 && m_conn_pool.empty())
+                    m_growPending = true;   // 仍有等待者，继续新建
+            }
+            continue;
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (now < nextRound)
+            continue;
+
+        nextRound = now + std::chrono::seconds(1);
+        growPaused = false;
+
+        std::vector<MYSQL*> toClose;
+        std::vector<MYSQL*> toPing;
+
+        // 队首为空闲最久的连接
+        while (!m_conn_pool.empty() && m_conn_nums > m_minConns && now - m_conn_pool.front().since >= std::chrono::seconds(SQL_IDLE_TIMEOUT_S)) {
+            toClose.push_back(m_conn_pool.front().conn);
+            m_conn_pool.pop_front();
+            m_conn_nums--;
+        }
+
+        // 检测期间视为使用中，不会被取走
+        while (!m_conn_pool.empty() && now - m_conn_pool.front().since >= std::chrono::seconds(SQL_PING_INTERVAL_S)) {
+            toPing.push_back(m_conn_pool.front().conn);
+            m_conn_pool.pop_front();
+            m_used_count++;
+        }
+
+        const int refill = std::max(0, m_minConns - m_conn_nums);
+        m_conn_nums += refill;
+        m_used_count += refill;
+
+        locker.unlock();
+
+        for (MYSQL* conn : toClose)
+            disconnect(conn);
+
+        for (MYSQL* conn : toPing)
+            freeConn(conn, mysql_ping(conn) != 0);
+
+        for (int i = 0; i < refill; i++)
+            freeConn(connect());
+
+        locker.lock();
+    }
+}
+
+/**
+ * @brief 销毁连接池，使用中的连接在归还时关闭
+ */
+void SqlConnPool::destoryPool() {
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+
+        if (m_closed)
+            return;
+        m_closed = true;
+    }
+
+    m_stopCond.notify_all();
+    m_cond.notify_all();
+
+    if (m_maintainer.joinable())
+        m_maintainer.join();
+
+    for (std::thread& warmer : m_warmers)
+        warmer.join();
+    m_warmers.clear();
+
+    std::deque<IdleConn> idle;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        idle.swap(m_conn_pool);
+        m_conn_nums -= static_cast<int>(idle.size());
+    }
+
+    for (const IdleConn& c : idle)
+        disconnect(c.conn);
+
     Logger::Instance()->LOG_INFO("数据库连接池销毁");
 }
+
+/**
+ * @param timeoutMS 取连接的等待上限
+ */
+SqlConnGuard::SqlConnGuard(int timeoutMS)
+    :m_conn(nullptr), m_broken(false), m_trial(false), m_start(CircuitBreaker::Clock::now()) {
+    SqlConnPool* pool = SqlConnPool::Instance();
+
+    if (!pool->m_breaker.allow(m_trial))
+        return;
+
+    m_conn = pool->getConn(timeoutMS);
+
+    // 取不到连接本身即为一次失败
+    if (!m_conn)
+        pool->m_breaker.record(m_trial, false, CircuitBreaker::Clock::now() - m_start);
+}
+
+SqlConnGuard::~SqlConnGuard() {
+    if (!m_conn)
+        return;
+
+    SqlConnPool* pool = SqlConnPool::Instance();
+    pool->m_breaker.record(m_trial, !m_broken, CircuitBreaker::Clock::now() - m_start);
+    pool->freeConn(m_conn, m_broken);
+}
+
+SqlConnGuard::operator bool() const {
+    return m_conn != nullptr;
+}
+
+MYSQL* SqlConnGuard::get() const {
+    return m_conn;
+}
+
+MYSQL_STMT* SqlConnGuard::stmt(SQL_STMT id) const {
+    assert(m_conn);
+    return SqlConnPool::Instance()->getStmt(m_conn, id);
+}
+
+void SqlConnGuard::invalidate() {
+    m_broken = true;
+}
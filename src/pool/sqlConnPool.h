@@ -2,18 +2,35 @@
 #define _SQL_CONN_POOL_H
 
 #include <mysql/mysql.h>
-#include <queue>
+#include <deque>
+#include <vector>
 #include <mutex>
-#include <semaphore.h>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <array>
+#include <unordered_map>
+#include <string_view>
+#include <initializer_list>
+#include <cstring>
+#include <cassert>
 
 #include "../logger/logger.h"
+#include "../config/serverConfig.h"
+#include "circuitBreaker.h"
 
-struct SqlConnInfo {
-    int port;
-    const char* host;
-    const char* user;
-    const char* pwd;
-    const char* db_name;
+#define SQL_MAX_PARAMS          8       // 预编译语句的参数个数上限
+#define SQL_ACQUIRE_TIMEOUT_MS  500     // 取连接的默认等待上限，超时即失败，不无限阻塞
+#define SQL_GROW_WAIT_MS        5       // 等待超过该时长仍无空闲连接时请后台线程新建连接(未达上限时)
+#define SQL_PING_INTERVAL_S     30      // 空闲超过该时长的连接由后台线程 ping，失效则关闭
+#define SQL_IDLE_TIMEOUT_S      60      // 空闲超过该时长且多于下限的连接被关闭
+
+// 预编译语句，每个连接各自预编译一份，与连接一同缓存
+enum SQL_STMT {
+    _SELECT_PASSWORD,   // 参数: username；结果: password
+    _INSERT_USER,       // 参数: username, password
+    _SQL_STMT_NUMS
 };
 
 class SqlConnPool {
@@ -24,22 +41,96 @@ public:
     static SqlConnPool* Instance();
 
 public:
-    void init(int conn_nums, SqlConnInfo* info);
-    MYSQL* getConn();
-    void freeConn(MYSQL* conn);
+    void init(int minConns, int maxConns, SqlConnInfo* info);
+    MYSQL* getConn(int timeoutMS = SQL_ACQUIRE_TIMEOUT_MS);
+    void freeConn(MYSQL* conn, bool broken = false);
     void destoryPool();
+    int getConnNums();
+
+    MYSQL_STMT* getStmt(MYSQL* conn, SQL_STMT id);
+    static bool execute(MYSQL_STMT* stmt, std::initializer_list<std::string_view> params);
 
 private:
-    int m_conn_nums;
-    std::queue<MYSQL*> m_conn_pool;
+    using Clock = std::chrono::steady_clock;
+
+    struct IdleConn {
+        MYSQL* conn;
+        Clock::time_point since;    // 归还时间
+    };
+
+    // 连接参数在重连时复用，须自行保存
+    int m_port;
+    std::string m_host;
+    std::string m_user;
+    std::string m_pwd;
+    std::string m_dbName;
+    unsigned int m_connectTimeout;
+    unsigned int m_readTimeout;
+    unsigned int m_writeTimeout;
+
+    int m_minConns;
+    int m_maxConns;
+    int m_conn_nums = 0;            // 已建立的连接(含使用中与正在建立的)
+    std::deque<IdleConn> m_conn_pool;   // 空闲连接，后进先出，队首为空闲最久的连接
 
     std::mutex m_mutex;
-    sem_t m_sem;
+    std::condition_variable m_cond;
 
-    int m_used_count;
-    int m_freed_count;
+    int m_used_count = 0;
+    size_t m_timeout_count = 0;     // 取连接超时次数
 
+    // 连接 -> 其上的预编译语句；增删在锁内，语句只由持有该连接的线程使用
+    std::unordered_map<MYSQL*, std::array<MYSQL_STMT*, _SQL_STMT_NUMS>> m_stmts;
+
+    // 后台维护: 检测空闲连接、收缩多余连接、按需新建连接
+    std::thread m_maintainer;
+    std::vector<std::thread> m_warmers;     // 启动时并行建立连接
+    int m_warming = 0;                      // 其中尚未完成的数量
+    int m_waiting = 0;                      // 在 getConn 中等待的调用方
+    bool m_growPending = false;             // 有调用方等待过久，请后台线程新建连接
+    std::condition_variable m_stopCond;     // 唤醒后台线程: 销毁或新建请求
+    bool m_closed = true;
+
+    // 经 SqlConnGuard 取用的连接的出错与耗时由其统计
+    CircuitBreaker m_breaker;
+
+    static const char* const SQL_STMT_TEXT[];
     static SqlConnPool s_sqlConnPool;
+
+    friend class SqlConnGuard;
+
+    MYSQL* connect();
+    void disconnect(MYSQL* conn);
+    void warmup();
+    void maintain();
+    static MYSQL_STMT* prepare(MYSQL* conn, SQL_STMT id);
+};
+
+/**
+ * @brief 连接的RAII持有者，离开作用域时归还连接，提前返回也不会泄漏
+ *        取连接经过熔断器: 熔断时直接取不到连接；持有期间的出错(invalidate)与耗时计入熔断统计
+ */
+class SqlConnGuard {
+public:
+    explicit SqlConnGuard(int timeoutMS = SQL_ACQUIRE_TIMEOUT_MS);
+    ~SqlConnGuard();
+
+    SqlConnGuard(const SqlConnGuard&) = delete;
+    SqlConnGuard& operator=(const SqlConnGuard&) = delete;
+
+public:
+    explicit operator bool() const;     // 是否取得连接(超时、熔断或数据库不可用时为 false)
+    MYSQL* get() const;
+    MYSQL_STMT* stmt(SQL_STMT id) const;
+
+    // 连接已失效(如执行出错)，归还时关闭
+    void invalidate();
+
+private:
+    MYSQL* m_conn;
+    bool m_broken;
+    bool m_trial;
+    CircuitBreaker::Clock::time_point m_start;
 };
 
 #endif // _SQL_CONN_POOL_H
@@ -0,0 +1,39 @@
+#include "connTable.h"
+
+ConnTable::ConnTable(int maxFd) {
+    assert(maxFd > 0);
+
+    m_slots.resize(maxFd);
+}
+
+/**
+ * @brief 获取fd对应的连接对象，槽位为空时创建，否则复用
+ * 
+ * @param fd 
+ * @return HttpConn* 超出容量返回nullptr
+ */
+HttpConn* ConnTable::acquire(int fd) {
+    if (fd < 0 || fd >= capacity())
+        return nullptr;
+
+    if (!m_slots[fd])
+        m_slots[fd] = std::make_unique<HttpConn>();
+
+    return m_slots[fd].get();
+}
+
+/**
+ * @brief 获取fd对应的连接对象
+ * 
+ * @param fd 
+ * @return HttpConn* 
+ */
+HttpConn* ConnTable::get(int fd) const {
+    assert(fd >= 0 && fd < capacity() && m_slots[fd]);
+
+    return m_slots[fd].get();
+}
+
+int ConnTable::capacity() const {
+    return static_cast<int>(m_slots.size());
+}
@@ -0,0 +1,29 @@
+/*
+    连接表: 以fd为下标的预分配槽位，连接关闭后槽位保留供复用同一fd的新连接
+*/
+
+#ifndef _CONN_TABLE_H
+#define _CONN_TABLE_H
+
+#include <memory>
+#include <vector>
+#include <cassert>
+
+#include "../http/httpConn.h"
+
+class ConnTable {
+public:
+    explicit ConnTable(int maxFd);
+    ~ConnTable() = default;
+
+public:
+    HttpConn* acquire(int fd);
+    HttpConn* get(int fd) const;
+    int capacity() const;
+
+private:
+    // 槽位数组本身不会扩容，线程池中的事务访问连接时无需担心rehash
+    std::vector<std::unique_ptr<HttpConn>> m_slots;
+};
+
+#endif  // _CONN_TABLE_H
@@ -0,0 +1,39 @@
+#include "eventLoop.h"
+
+EventLoop::EventLoop() {
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+EventLoop::~EventLoop() {
+    close(m_wakeupFd);
+}
+
+/**
+ * @brief 投递任务至本循环线程执行(线程安全)
+ *
+ * @param task
+ */
+void EventLoop::queueInLoop(std::function<void()>&& task) {
+    {
+        std::lock_guard<std::mutex> locker(m_pendingMtx);
+        m_pendingTasks.emplace_back(std::move(task));
+    }
+
+    uint64_t one = 1;
+    if (::write(m_wakeupFd, &one, sizeof(one)) != sizeof(one))
+        Logger::Instance()->LOG_ERROR("event loop wakeup error");
+}
+
+/**
+ * @brief 执行其他线程投递的任务
+ */
+void EventLoop::runPendingTasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> locker(m_pendingMtx);
+        tasks.swap(m_pendingTasks);
+    }
+
+    for (auto& task : tasks)
+        task();
+}
@@ -0,0 +1,37 @@
+/*
+    事件循环基类: 跨线程任务投递与唤醒
+*/
+
+#ifndef _EVENT_LOOP_H
+#define _EVENT_LOOP_H
+
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "../logger/logger.h"
+
+class EventLoop {
+public:
+    EventLoop();
+    virtual ~EventLoop();
+
+public:
+    virtual bool init(int listenFd) = 0;
+    virtual void loop() = 0;
+
+    void queueInLoop(std::function<void()>&& task);
+
+protected:
+    int m_wakeupFd;     // eventfd, 跨线程唤醒
+
+    void runPendingTasks();
+
+private:
+    std::mutex m_pendingMtx;
+    std::vector<std::function<void()>> m_pendingTasks;
+};
+
+#endif  // _EVENT_LOOP_H
@@ -0,0 +1,318 @@
+#include "reactor.h"
+
+const int Reactor::MAX_FD = 65535;   // 最大的连接数
+
+Reactor::Reactor(uint32_t listenEvents, uint32_t connEvents, int timeoutMS, ThreadPool* threadPool, ThreadPool* dbPool, bool inlineIO, int acceptBatch)
+    :m_listenEvents(listenEvents), m_connEvents(connEvents), m_timeoutMS(timeoutMS), m_inline(inlineIO), m_acceptBatch(acceptBatch),
+     m_listenFd(-1), m_threadPool(threadPool), m_dbPool(dbPool) {
+    // epoller && 时间最小堆 初始化
+    m_epoller = std::make_unique<Epoller>();
+    m_timer = std::make_unique<HeapTimer>();
+
+    // 连接表初始化
+    m_users = std::make_unique<ConnTable>(MAX_FD + 1);
+    m_deferred = std::make_unique<std::atomic<DEFER_MARK>[]>(MAX_FD + 1);   // 值初始化为 _IDLE
+}
+
+/**
+ * @brief 挂载监听fd与唤醒fd
+ *
+ * @param listenFd 已完成listen的fd
+ * @return true  成功
+ * @return false 失败
+ */
+bool Reactor::init(int listenFd) {
+    m_listenFd = listenFd;
+
+    if (m_wakeupFd < 0 || !m_epoller->addFd(m_wakeupFd, EPOLLIN)) {
+        Logger::Instance()->LOG_ERROR("Add wakeupFd into epoll error");
+        return false;
+    }
+
+    if (!m_epoller->addFd(m_listenFd, m_listenEvents | EPOLLIN)) {
+        Logger::Instance()->LOG_ERROR("Add listenFd into epoll error");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 事件循环
+ */
+void Reactor::loop() {
+    int timeout_interval = -1;
+
+    while (1) {
+        if (m_timeoutMS > 0)
+            timeout_interval = m_timer->getNextTick();
+
+        int readyCnt = m_epoller->wait(timeout_interval);
+
+        for (int i = 0; i < readyCnt; i++) {
+            int fd = m_epoller->getFd(i);
+            uint32_t events = m_epoller->getEvents(i);
+
+            if (fd == m_listenFd)
+                handleListen();
+            else if (fd == m_wakeupFd)
+                handleWakeup();
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                handleClose(m_users->get(fd));
+            else if (events & EPOLLIN)
+                handleRead(m_users->get(fd));
+            else if (events & EPOLLOUT)
+                handleWrite(m_users->get(fd));
+            else {
+                std::string msg = "unresolved events: " + std::to_string(events);
+                Logger::Instance()->LOG_ERROR(msg);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 执行其他线程投递的任务
+ */
+void Reactor::handleWakeup() {
+    uint64_t cnt = 0;
+    if (::read(m_wakeupFd, &cnt, sizeof(cnt)) != sizeof(cnt))
+        return;
+
+    runPendingTasks();
+}
+
+/**
+ * @brief 处理新连接事务
+ *
+ * ET模式下单轮最多accept m_acceptBatch 个连接，未取完时投递到下一轮继续，避免连接风暴饿死已有连接
+ */
+void Reactor::handleListen() {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int accepted = 0;
+
+    do {
+        if (m_acceptBatch > 0 && accepted >= m_acceptBatch) {
+            // 边沿已被消费，剩余连接不会再次触发事件
+            queueInLoop([this] { handleListen(); });
+            return;
+        }
+
+        len = sizeof(addr);
+        int fd = accept4(m_listenFd, (struct sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd <= 0)
+            return;
+
+        accepted++;
+
+        HttpConn* conn = nullptr;
+        if (HttpConn::s_usersCount >= MAX_FD || !(conn = m_users->acquire(fd))) {
+            fulledReject(fd, "The connection was interrupted due to server overload");
+            Logger::Instance()->LOG_WARNING("server busy");
+            continue;
+        }
+
+        // 初始化Conn类，槽位中的对象被复用
+        conn->init(fd, addr);
+
+        if (m_timeoutMS > 0)
+            m_timer->add(fd, m_timeoutMS, std::bind(&Reactor::handleClose, this, conn));     // 将该fd绑定到最小堆计时器上，同时cb设置为断开连接事件
+
+        m_epoller->addFd(fd, EPOLLIN | m_connEvents);
+
+        std::string msg = "Client - " + std::to_string(fd) + " conn in";
+        Logger::Instance()->LOG_INFO(msg);
+        msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
+        Logger::Instance()->LOG_INFO(msg);
+
+    } while (m_listenEvents & EPOLLET); // accept all if listen mode is ET
+}
+
+/**
+ * @brief 处理断开事务
+ *
+ * @param conn ptr
+ */
+void Reactor::handleClose(HttpConn* conn) {
+    assert(conn);
+
+    // 处理函数正在数据库线程中执行，待其回到本循环后再关闭
+    DEFER_MARK mark = _RUNNING;
+    if (m_deferred[conn->getFd()].compare_exchange_strong(mark, _CLOSE_PENDING) || mark == _CLOSE_PENDING)
+        return;
+
+    // 先移出epoll再关闭fd，否则fd被新连接复用后会被误删
+    m_epoller->delFd(conn->getFd());
+
+    if (conn->doClose()) {
+        std::string msg = "Client - " + std::to_string(conn->getFd()) + " conn close";
+        Logger::Instance()->LOG_INFO(msg);
+        msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
+        Logger::Instance()->LOG_INFO(msg);
+    }
+}
+
+/**
+ * @brief 处理读取事务
+ *
+ * @param conn ptr
+ */
+void Reactor::handleRead(HttpConn* conn) {
+    assert(conn);
+
+    extendExpire(conn);     // 该连接被触发，延长活动时间
+
+    if (m_inline)
+        _doRead(conn);
+    else
+        m_threadPool->addTask(std::bind(&Reactor::_doRead, this, conn));     // 读操作丢入线程池
+}
+
+/**
+ * @brief 读操作
+ *
+ * @param conn ptr
+ */
+void Reactor::_doRead(HttpConn* conn) {
+    assert(conn);
+
+    int ret = -1;
+    int readErrno = 0;
+
+    ret = conn->read(&readErrno);   //  从fd读取数据放入readBuffer
+    if (ret < 0 && readErrno != EAGAIN) {
+        handleClose(conn);
+        return;
+    }
+
+    _doProcess(conn);   // 开始处理读入数据
+}
+
+/**
+ * @brief 处理写出事务
+ *
+ * @param conn ptr
+ */
+void Reactor::handleWrite(HttpConn* conn) {
+    assert(conn);
+
+    extendExpire(conn);
+
+    if (m_inline)
+        _doWrite(conn);
+    else
+        m_threadPool->addTask(std::bind(&Reactor::_doWrite, this, conn));
+}
+
+/**
+ * @brief 写操作
+ *
+ * @param conn ptr
+ */
+void Reactor::_doWrite(HttpConn* conn) {
+    assert(conn);
+
+    int ret = -1;
+    int writeErrno = 0;
+
+    ret = conn->write(&writeErrno);    //  从writeBuffer(响应对象)和mmap(资源文件)映射写出至fd
+
+    if (conn->bytesToSend() == 0) { // has send all
+        if (conn->isKeepAlive()) {
+            _doProcess(conn);   // 继续处理流水线中剩余的请求
+            return;
+        }
+    }else if (ret < 0) {
+        if (writeErrno == EAGAIN) { // try once
+            m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLOUT);
+            return;
+        }
+    }
+
+    handleClose(conn);
+}
+
+/**
+ * @brief 解析readBuffer，组装响应对象，映射至iovWrite
+ *
+ * 已组装的响应先写出，遇到阻塞处理函数时待写完再交给数据库线程
+ *
+ * @param conn ptr
+ */
+void Reactor::_doProcess(HttpConn* conn) {
+    if (!conn->isDeferred() && conn->process()) {  // 处理是否成功代表响应对象是否成功组装
+        if (m_inline)
+            _doWrite(conn); // 循环线程内直接尝试写出，写不完再等待EPOLLOUT
+        else
+            m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLOUT);
+    }
+    else if (conn->isDeferred())
+        _doDefer(conn);
+    else
+        m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLIN);
+}
+
+/**
+ * @brief 将阻塞处理函数交给数据库线程执行，期间连接脱离epoll，不再读入数据；
+ *        完成后回到本循环继续处理，其他连接的请求不受影响
+ *
+ * @param conn ptr
+ */
+void Reactor::_doDefer(HttpConn* conn) {
+    const int fd = conn->getFd();
+
+    // 先标记再脱离epoll，其间到来的关闭都会推迟到处理函数完成后
+    m_deferred[fd].store(_RUNNING);
+    m_epoller->delFd(fd);
+
+    m_dbPool->addTask([this, conn, fd] {
+        conn->runDeferred();
+
+        queueInLoop([this, conn, fd] {
+            if (m_deferred[fd].exchange(_IDLE) == _CLOSE_PENDING) {
+                handleClose(conn);
+                return;
+            }
+
+            m_epoller->addFd(fd, m_connEvents);
+
+            if (m_inline)
+                _doProcess(conn);
+            else
+                m_threadPool->addTask(std::bind(&Reactor::_doProcess, this, conn));
+        });
+    });
+}
+
+/**
+ * @brief 服务器满负载拒绝连接
+ *
+ * @param fd 用户fd
+ * @param msg 返回消息
+ */
+void Reactor::fulledReject(int fd, const char* msg) {
+    assert(fd > 0);
+
+    if (send(fd, msg, strlen(msg), 0) < 0) {
+        std::string msg = "the msg that indicated server is busy has been sended in error, fd: ";
+        msg += std::to_string(fd);
+
+        Logger::Instance()->LOG_ERROR(msg);
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief 延长连接活动时间
+ *
+ * @param conn ptr
+ */
+void Reactor::extendExpire(HttpConn* conn) {
+    assert(conn->getFd() > 0);
+
+    if (m_timeoutMS > 0)
+        m_timer->adjust(conn->getFd(), m_timeoutMS);
+}
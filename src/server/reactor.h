@@ -0,0 +1,86 @@
+/*
+    事件循环(reactor)封装
+    one loop per thread: 每个reactor独占 epoller、时间最小堆、监听fd 与其上的连接
+*/
+
+#ifndef _REACTOR_H
+#define _REACTOR_H
+
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <string>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+
+#include "eventLoop.h"
+#include "epoller.h"
+#include "../pool/threadPool.h"
+#include "../timer/heapTimer.h"
+#include "connTable.h"
+#include "../logger/logger.h"
+
+class Reactor: public EventLoop {
+public:
+    /**
+     * @param listenEvents 监听fd事件模式
+     * @param connEvents   连接fd事件模式
+     * @param timeoutMS    连接超时时间
+     * @param threadPool   事务线程池
+     * @param dbPool       数据库线程池，执行阻塞的处理函数
+     * @param inlineIO     true - 读写解析在本线程内完成
+     *                     false - 所有读写事务丢入线程池
+     * @param acceptBatch  每轮循环最多accept的连接数
+     */
+    Reactor(uint32_t listenEvents, uint32_t connEvents, int timeoutMS, ThreadPool* threadPool, ThreadPool* dbPool, bool inlineIO, int acceptBatch);
+    ~Reactor() = default;
+
+public:
+    bool init(int listenFd) override;
+    void loop() override;
+
+    static const int MAX_FD;
+
+private:
+    uint32_t m_listenEvents;
+    uint32_t m_connEvents;
+    int m_timeoutMS;
+    bool m_inline;
+    int m_acceptBatch;
+
+    int m_listenFd;
+
+    std::unique_ptr<HeapTimer> m_timer;
+    std::unique_ptr<Epoller> m_epoller;
+    ThreadPool* m_threadPool;
+    ThreadPool* m_dbPool;
+    std::unique_ptr<ConnTable> m_users;   // 各reactor独立持有，连接只在所属循环内被访问
+
+    // 连接的阻塞处理函数执行状态，按fd索引
+    // 单reactor模式下由循环线程(超时、挂断)与事务线程(读写出错、投递处理函数)同时访问，须为原子量
+    enum DEFER_MARK : uint8_t {
+        _IDLE,
+        _RUNNING,           // 数据库线程执行中
+        _CLOSE_PENDING      // 执行中且需要关闭
+    };
+    std::unique_ptr<std::atomic<DEFER_MARK>[]> m_deferred;
+
+private:
+    void handleListen();
+    void handleClose(HttpConn* conn);
+    void handleRead(HttpConn* conn);
+    void handleWrite(HttpConn* conn);
+    void handleWakeup();
+
+    void fulledReject(int fd, const char* msg);
+    void extendExpire(HttpConn* conn);
+
+    void _doRead(HttpConn* conn);
+    void _doWrite(HttpConn* conn);
+    void _doProcess(HttpConn* conn);
+    void _doDefer(HttpConn* conn);
+};
+
+#endif  // _REACTOR_H
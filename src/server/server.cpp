@@ -1,6 +1,11 @@
 #include "server.h"
 
-const int Server::MAX_FD = 65535;   // 最大的连接数
+#include <algorithm>
+
+#ifdef WITH_MYSQL
+#include "../pool/sqlConnPool.h"
+#endif
+
 short Server::s_forceQuit = 0;      // 强退等待标识
 
 /**
@@ -8,40 +13,58 @@ short Server::s_forceQuit = 0;      // 强退等待标识
  * 
  * @param baseConfig    服务器基础配置
  * @param sqlConfig     数据库配置
+ * @param authConfig    账户存储配置
  * @param loggerConfig  日志系统配置
  * @param threadNums    事务线程数量
- * @param sqlConnNums   数据库连接池中连接实例数量
+ * @param sqlConnNums   数据库连接池中连接实例数量上限，下限为其 1/4
  * @param loggerQueSize 日志系统阻塞队列大小
  */
 Server::Server(
-    BaseConfig* baseConfig, SQLConfig* sqlConfig, LoggerConfig* loggerConfig,
+    BaseConfig* baseConfig, SQLConfig* sqlConfig, AuthConfig* authConfig, LoggerConfig* loggerConfig,
     int threadNums, int sqlConnNums, int loggerQueSize
 ) {
     char* srcDir = getcwd(nullptr, 256);
 
     HttpConn::s_usersCount = 0;
     HttpConn::s_srcDir = std::string(srcDir) + "/static";  // 静态资源路径
+    HttpRequest::s_maxBodySize = baseConfig->_maxBodySize;
 
     m_port = baseConfig->_port;
     m_timeoutMS = baseConfig->_timeoutMS;
+    m_reactorNums = baseConfig->_reactorNums;
+    m_ioEngine = baseConfig->_ioEngine;
+    m_listener = baseConfig->_listener;
     initEventsMode(baseConfig->_modeChoice);    // io多路复用类型
 
     // 日志模块初始化
     Logger::Instance()->init(loggerConfig->_level, loggerConfig->_device, loggerConfig->_path, loggerConfig->_suffix, loggerQueSize);
 
-    // 数据库连接池模块初始化
-    SqlConnPool::Instance()->init(sqlConnNums, sqlConfig);
+    // 数据库连接池模块初始化，仅 MySQL 账户存储需要
+#ifdef WITH_MYSQL
+    if (authConfig->_backend == _AUTH_MYSQL)
+        SqlConnPool::Instance()->init(std::max(1, sqlConnNums / 4), sqlConnNums, sqlConfig);
+#endif
+
+    // 账户存储初始化
+    if (!AuthStore::init(*authConfig)) {
+        Logger::Instance()->LOG_ERROR("账户存储启动失败");
+        exit(-2);
+    }
 
     // 线程池模块初始化
     m_threadPool = std::make_unique<ThreadPool>(threadNums);
 
-    // epoller && 时间最小堆 初始化
-    m_epoller = std::make_unique<Epoller>();
-    m_timer = std::make_unique<HeapTimer>();
+    // 数据库线程与连接一一对应，取连接时不会阻塞
+    m_dbPool = std::make_unique<ThreadPool>(sqlConnNums);
 
-    // 服务器端口初始化
+    // 静态资源缓存初始化
+    FileCache::Instance()->init(HttpConn::s_srcDir);
+
+    // 路由表初始化
+    initRoutes();
+
+    // 服务器端口 && reactor 初始化
     if (!initialize(baseConfig->_lingerUsing)) {
-        close(m_listenFd);
         Logger::Instance()->LOG_ERROR("服务器启动失败");
 
         serverShutdown();
@@ -57,177 +80,50 @@ Server::~Server() {
 }
 
 /**
- * @brief 
- */
-void Server::run() {
-    int timeout_interval = -1;
-
-    while (1) {
-        if (m_timeoutMS > 0) 
-            timeout_interval = m_timer->getNextTick();
-
-        int readyCnt = m_epoller->wait(timeout_interval);
-
-        for (int i = 0; i < readyCnt; i++) {
-            int fd = m_epoller->getFd(i);
-            uint32_t events = m_epoller->getEvents(i);
-
-            if (fd == m_listenFd) 
-                handleListen();
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) 
-                handleClose(&m_users[fd]);
-            else if (events & EPOLLIN) 
-                handleRead(&m_users[fd]);
-            else if (events & EPOLLOUT) 
-                handleWrite(&m_users[fd]);
-            else {
-                std::string msg = "unresolved events: " + std::to_string(events);
-                Logger::Instance()->LOG_ERROR(msg);
-            }
-        }
-    }
-}
-
-/**
- * @brief 处理新连接事务
- */
-void Server::handleListen() {
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-
-    do {
-        int fd = accept(m_listenFd, (struct sockaddr*)&addr, &len);
-        
-        if (fd <= 0)
-            return;
-        else if (HttpConn::s_usersCount >= MAX_FD) {
-            fulledReject(fd, "The connection was interrupted due to server overload");
-            Logger::Instance()->LOG_WARNING("server busy");
-            return;
-        }
-
-        // add client
-        // if (m_users.count(fd) == 0) 
-        //     m_users.emplace(fd, new HttpConn());
-
-        // 初始化Conn类
-        // 访问unordered_map没有的key会默认调用无参构造
-        m_users[fd].init(fd, addr);
-
-        if (m_timeoutMS > 0) 
-            m_timer->add(fd, m_timeoutMS, std::bind(&Server::handleClose, this, &m_users[fd]));     // 将该fd绑定到最小堆计时器上，同时cb设置为断开连接事件
-
-        m_epoller->addFd(fd, EPOLLIN | m_connEvents);
-
-        setNonBlocking(fd);
-        std::string msg = "Client - " + std::to_string(fd) + " conn in";
-        Logger::Instance()->LOG_INFO(msg);
-        msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
-        Logger::Instance()->LOG_INFO(msg);
-
-    } while (m_listenEvents & EPOLLET); // accept all if listen mode is ET
-}
-
-/**
- * @brief 处理断开事务
- * 
- * @param conn ptr
- */
-void Server::handleClose(HttpConn* conn) {
-    assert(conn);
-
-    if (conn->doClose()) {
-        std::string msg = "Client - " + std::to_string(conn->getFd()) + " conn close";
-        Logger::Instance()->LOG_INFO(msg);
-        msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
-        Logger::Instance()->LOG_INFO(msg);
-    }
-
-    m_epoller->delFd(conn->getFd());
-}
-
-/**
- * @brief 处理读取事务
- * 
- * @param conn ptr
+ * @brief 注册路由: 内置页面别名、登录注册处理函数，其余路径映射为静态资源
  */
-void Server::handleRead(HttpConn* conn) {
-    assert(conn);
-
-    extendExpire(conn);     // 该连接被触发，延长活动时间
-    m_threadPool->addTask(std::bind(&Server::_doRead, this, conn));     // 读操作丢入线程池
+void Server::initRoutes() {
+    static const std::pair<const char*, const char*> DEFAULT_HTML[] = {
+        { "/",          "/index.html" },
+        { "/index",     "/index.html" },
+        { "/login",     "/login.html" },
+        { "/register",  "/register.html" },
+        { "/welcome",   "/welcome.html" },
+        { "/picture",   "/picture.html" },
+        { "/video",     "/video.html" },
+        { "/error",     "/error.html" },
+    };
+
+    Router* router = Router::Instance();
+
+    router->init(HttpConn::s_srcDir);
+    router->mount("/", HttpConn::s_srcDir);
+
+    for (auto& [path, page] : DEFAULT_HTML)
+        router->addPage(path, page);
+
+    // 登录页与注册页的表单均提交至自身；账户存储会阻塞时由数据库线程执行
+    for (const char* path : { "/login", "/login.html", "/register", "/register.html" })
+        router->addRoute("POST", path, AccountHandler::handle, AuthStore::Instance()->blocking());
 }
 
 /**
- * @brief 读操作
- * 
- * @param conn ptr
+ * @brief 启动事件循环
+ *
+ * 单reactor模式下在主线程运行循环；多reactor模式下每个reactor独占一个线程
  */
-void Server::_doRead(HttpConn* conn) {
-    assert(conn);
-
-    int ret = -1;
-    int readErrno = 0;
-    
-    ret = conn->read(&readErrno);   //  从fd读取数据放入readBuffer
-    if (ret < 0 && readErrno != EAGAIN) {
-        handleClose(conn);
+void Server::run() {
+    if (m_reactorNums == 0) {
+        m_reactors[0]->loop();
         return;
     }
 
-    _doProcess(conn);   // 开始处理读入数据
-}
-
-/**
- * @brief 处理写出事务
- * 
- * @param conn ptr
- */
-void Server::handleWrite(HttpConn* conn) {
-    assert(conn);
-
-    extendExpire(conn);
-    m_threadPool->addTask(std::bind(&Server::_doWrite, this, conn));
-}
-
-/**
- * @brief 写操作
- * 
- * @param conn ptr
- */
-void Server::_doWrite(HttpConn* conn) {
-    assert(conn);
-
-    int ret = -1;
-    int writeErrno = 0;
-
-    ret = conn->write(&writeErrno);    //  从writeBuffer(响应对象)和mmap(资源文件)映射写出至fd
-
-    if (conn->bytesToSend() == 0) { // has send all
-        if (conn->isKeepAlive()) {
-            _doProcess(conn);
-            return;
-        }
-    }else if (ret < 0) {
-        if (writeErrno == EAGAIN) { // try once
-            m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLOUT);
-            return;
-        }
-    }
-
-    handleClose(conn);
-}
+    std::vector<std::thread> loops;
+    for (auto& reactor : m_reactors)
+        loops.emplace_back(&EventLoop::loop, reactor.get());
 
-/**
- * @brief 解析readBuffer，组装响应对象，映射至iovWrite
- * 
- * @param conn ptr
- */
-void Server::_doProcess(HttpConn* conn) {
-    if (conn->process())    // 处理是否成功代表响应对象是否成功组装
-        m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLOUT);
-    else
-        m_epoller->modFd(conn->getFd(), m_connEvents | EPOLLIN);
+    for (auto& t : loops)
+        t.join();
 }
 
 /**
@@ -237,7 +133,12 @@ void Server::_doProcess(HttpConn* conn) {
  */
 void Server::initEventsMode(int choice) {
     m_listenEvents = EPOLLRDHUP;    // EPOLLRDHUP - socket关闭触发
-    m_connEvents = EPOLLRDHUP | EPOLLONESHOT;   // EPOLLONESHOT - 保证一个socket连接在任一时刻只被一个线程处理
+    m_connEvents = EPOLLRDHUP;
+
+    // EPOLLONESHOT - 保证一个socket连接在任一时刻只被一个线程处理
+    // 多reactor模式下连接只在所属循环线程内处理，无需每次重新注册
+    if (m_reactorNums == 0)
+        m_connEvents |= EPOLLONESHOT;
 
     switch(choice) {
         case 0:
@@ -261,54 +162,72 @@ void Server::initEventsMode(int choice) {
 }
 
 /**
- * @brief 服务器满负载拒绝连接
+ * @brief 服务器初始化
  * 
- * @param fd 用户fd
- * @param msg 返回消息
+ * @param lingerUsing 是否关闭逗留
+ * @return true  启动成功
+ * @return false 启动失败
  */
-void Server::fulledReject(int fd, const char* msg) {
-    assert(fd > 0);
+bool Server::initialize(bool lingerUsing) {
+    if (m_port < 1024 || m_port > 65535) {
+        Logger::Instance()->LOG_ERROR("非合理端口");
+        return false;
+    }
 
-    if (send(fd, msg, strlen(msg), 0) < 0) {
-        std::string msg = "the msg that indicated server is busy has been sended in error, fd: ";
-        msg += std::to_string(fd);
+    const bool multiReactor = m_reactorNums > 0;
+    const int reactorNums = multiReactor ? m_reactorNums : 1;
 
-        Logger::Instance()->LOG_ERROR(msg);
-    }
+    for (int i = 0; i < reactorNums; i++) {
+        // 多reactor模式下每个reactor持有独立的SO_REUSEPORT监听fd，由内核分发新连接
+        int listenFd = createListenFd(lingerUsing, multiReactor);
+        if (listenFd < 0)
+            return false;
 
-    close(fd);
-}
+        m_listenFds.push_back(listenFd);
 
-/**
- * @brief 延长连接活动时间
- * 
- * @param conn ptr
- */
-void Server::extendExpire(HttpConn* conn) {
-    assert(conn->getFd() > 0);
+        std::unique_ptr<EventLoop> reactor;
+
+        if (m_ioEngine == _IO_URING) {
+            reactor = std::make_unique<UringReactor>(m_timeoutMS, m_dbPool.get());
+
+            if (!reactor->init(listenFd)) {
+                if (i > 0)
+                    return false;
+
+                // 内核不支持时退回epoll
+                Logger::Instance()->LOG_WARNING("io_uring unavailable, fall back to epoll");
+                m_ioEngine = _EPOLL;
+                reactor.reset();
+            }
+        }
+
+        if (!reactor) {
+            reactor = std::make_unique<Reactor>(m_listenEvents, m_connEvents, m_timeoutMS, m_threadPool.get(), m_dbPool.get(), multiReactor, m_listener._acceptBatch);
+            if (!reactor->init(listenFd))
+                return false;
+        }
+
+        m_reactors.emplace_back(std::move(reactor));
+    }
+
+    Logger::Instance()->LOG_INFO("Server initialization done");
 
-    if (m_timeoutMS > 0)
-        m_timer->adjust(conn->getFd(), m_timeoutMS);
+    return true;
 }
 
 /**
- * @brief 服务器初始化
+ * @brief 创建监听fd
  * 
  * @param lingerUsing 是否关闭逗留
- * @return true  启动成功
- * @return false 启动失败
+ * @param reusePort   是否开启SO_REUSEPORT
+ * @return int 监听fd，失败返回-1
  */
-bool Server::initialize(bool lingerUsing) {
-    if (m_port < 1024 || m_port > 65535) {
-        Logger::Instance()->LOG_ERROR("非合理端口");
-        return false;
-    }
+int Server::createListenFd(bool lingerUsing, bool reusePort) {
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 
-    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
-
-    if (m_listenFd < 0) {
+    if (listenFd < 0) {
         Logger::Instance()->LOG_ERROR("Create socket error");
-        return false;
+        return -1;
     }
 
     struct linger lingerOpt = { 0 };
@@ -319,18 +238,29 @@ bool Server::initialize(bool lingerUsing) {
 
     int ret = 0;
     // 关闭连接后，允许未发完的数据逗留
-    ret = setsockopt(m_listenFd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
     if (ret < 0) {
         Logger::Instance()->LOG_ERROR("Sock option - linger error");
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     // 端口复用
     int reuseFlag = 1;
-    ret = setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&reuseFlag, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&reuseFlag, sizeof(int));
     if(ret < 0) {
         Logger::Instance()->LOG_ERROR("Sock option - reuse error");
-        return false;
+        close(listenFd);
+        return -1;
+    }
+
+    if (reusePort) {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void*)&reuseFlag, sizeof(int));
+        if(ret < 0) {
+            Logger::Instance()->LOG_ERROR("Sock option - reuseport error");
+            close(listenFd);
+            return -1;
+        }
     }
 
     struct sockaddr_in addr;
@@ -338,27 +268,35 @@ bool Server::initialize(bool lingerUsing) {
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(m_port);
 
-    ret = bind(m_listenFd, (struct sockaddr*)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr*)&addr, sizeof(addr));
     if (ret < 0) {
         Logger::Instance()->LOG_ERROR("Bind socket error");
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    ret = listen(m_listenFd, 6);
-    if (ret < 0) {
-        Logger::Instance()->LOG_ERROR("Listen socket error");
-        return false;
+    // 连接首个数据包到达后才唤醒accept，HTTP客户端总是先发送请求
+    if (m_listener._deferAcceptSec > 0) {
+        ret = setsockopt(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &m_listener._deferAcceptSec, sizeof(int));
+        if (ret < 0)
+            Logger::Instance()->LOG_WARNING("Sock option - defer accept error");
     }
 
-    if (!m_epoller->addFd(m_listenFd, m_listenEvents | EPOLLIN)) {
-        Logger::Instance()->LOG_ERROR("Add listenFd into epoll error");
-        return false;
+    // 允许携带cookie的客户端在SYN中附带请求数据
+    if (m_listener._fastOpenQlen > 0) {
+        ret = setsockopt(listenFd, IPPROTO_TCP, TCP_FASTOPEN, &m_listener._fastOpenQlen, sizeof(int));
+        if (ret < 0)
+            Logger::Instance()->LOG_WARNING("Sock option - fast open error");
     }
 
-    setNonBlocking(m_listenFd);
-    Logger::Instance()->LOG_INFO("Server initialization done");
+    ret = listen(listenFd, m_listener._backlog);
+    if (ret < 0) {
+        Logger::Instance()->LOG_ERROR("Listen socket error");
+        close(listenFd);
+        return -1;
+    }
 
-    return true;
+    return listenFd;
 }
 
 /**
@@ -382,29 +320,24 @@ void Server::interruptionHandler(int signal) {
  * @brief 关闭服务器
  */
 void Server::serverShutdown() {
-    close(m_listenFd);
+    for (int fd : m_listenFds)
+        close(fd);
+    m_listenFds.clear();
 
     // for (auto& pair : m_users) {
     //     close(pair.first);
     //     delete pair.second;
     // }
 
+    FileCache::Instance()->destroy();
+    AuthStore::destroy();
+#ifdef WITH_MYSQL
     SqlConnPool::Instance()->destoryPool();
+#endif
     Logger::Instance()->LOG_INFO("服务器关闭");
     Logger::Instance()->Destroy();
 }
 
-/**
- * @brief 将fd设置为非阻塞
- * 
- * @param fd
- */
-void Server::setNonBlocking(int fd) {
-    assert(fd);
-
-    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
-}
-
 /**
  * @brief 描述服务器初始化状态
  */
@@ -418,13 +351,30 @@ void Server::depictServerInit(bool lingerUsing, int threadNums, int sqlConnNums,
     msg = "端口: " + std::to_string(m_port) + "   自动断开超时时延: " + std::to_string(m_timeoutMS) + " ms" + "   是否开启连接逗留: " + (lingerUsing ? "是" : "否");
     logger->LOG_INFO(msg);
 
-    msg = std::string("listenFdMode: ") + (m_listenEvents & EPOLLET ? "ET" : "LT");
-    msg += std::string("   connFdMode: ") + (m_connEvents & EPOLLET ? "ET" : "LT");
+    if (m_ioEngine == _IO_URING)
+        msg = "ioEngine: io_uring";
+    else {
+        msg = std::string("ioEngine: epoll   listenFdMode: ") + (m_listenEvents & EPOLLET ? "ET" : "LT");
+        msg += std::string("   connFdMode: ") + (m_connEvents & EPOLLET ? "ET" : "LT");
+    }
+    logger->LOG_INFO(msg);
+
+    msg = "backlog: " + std::to_string(m_listener._backlog) + "   deferAccept: " + std::to_string(m_listener._deferAcceptSec) + " s"
+        + "   fastOpen: " + std::to_string(m_listener._fastOpenQlen) + "   acceptBatch: " + std::to_string(m_listener._acceptBatch);
+    logger->LOG_INFO(msg);
+
+    msg = "maxBodySize: " + std::to_string(HttpRequest::s_maxBodySize) + " bytes";
+    logger->LOG_INFO(msg);
+
+    msg = "reactor数量: " + (m_reactorNums > 0 ? std::to_string(m_reactorNums) : std::string("1 (事务交由线程池)"));
     logger->LOG_INFO(msg);
 
     msg = "线程池中线程数量: " + std::to_string(threadNums) + "   数据库连接池中实例数量: " + std::to_string(sqlConnNums);
     logger->LOG_INFO(msg);
 
+    msg = std::string("账户存储: ") + AuthStore::Instance()->name();
+    logger->LOG_INFO(msg);
+
     auto [levelStr, deviceStr, pathStr] = logger->loggerDesc();
     msg = "日志系统等级: " + levelStr + "   日志记录形式: " + deviceStr;
     if (deviceStr != "仅终端")
@@ -2,24 +2,28 @@
 #define _SERVER_H
 
 #include <memory>
-#include <unordered_map>
+#include <vector>
+#include <thread>
 #include <string>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #include <signal.h>
 
-#include "epoller.h"
+#include "reactor.h"
+#include "uringReactor.h"
 #include "../pool/threadPool.h"
-#include "../timer/heapTimer.h"
-#include "../http/httpConn.h"
 #include "../logger/logger.h"
 #include "../config/serverConfig.h"
+#include "../http/router.h"
+#include "../http/accountHandler.h"
+#include "../auth/authStore.h"
 
 class Server {
 public:
     explicit Server(
-        BaseConfig* baseConfig, SQLConfig* sqlConfig, LoggerConfig* loggerConfig,
+        BaseConfig* baseConfig, SQLConfig* sqlConfig, AuthConfig* authConfig, LoggerConfig* loggerConfig,
         int threadNums, int sqlConnNums, int loggerQueSize
     );
     ~Server();
@@ -28,7 +32,6 @@ public:
     void run();
 
 private:
-    static const int MAX_FD;
     static short s_forceQuit;
 
     uint32_t m_listenEvents;
@@ -37,33 +40,23 @@ private:
     int m_port;
     short m_modeChoice;
     int m_timeoutMS;
+    int m_reactorNums;
+    IoEngine m_ioEngine;
+    ListenerConfig m_listener;
 
-    int m_listenFd;
+    std::vector<int> m_listenFds;
 
-    std::unique_ptr<HeapTimer> m_timer;
-    std::unique_ptr<Epoller> m_epoller;
     std::unique_ptr<ThreadPool> m_threadPool;
-
-    std::unordered_map<int, HttpConn> m_users;
+    std::unique_ptr<ThreadPool> m_dbPool;     // 专用于阻塞的处理函数，数据库变慢时不拖累其他请求
+    std::vector<std::unique_ptr<EventLoop>> m_reactors;
 
 private:
     void initEventsMode(int choice);
-
-    void handleListen();
-    void handleClose(HttpConn* conn);
-    void handleRead(HttpConn* conn);
-    void handleWrite(HttpConn* conn);
-
-    void fulledReject(int fd, const char* msg);
-    void extendExpire(HttpConn* conn);
-
-    void _doRead(HttpConn* conn);
-    void _doWrite(HttpConn* conn);
-    void _doProcess(HttpConn* conn);
+    void initRoutes();
 
     bool initialize(bool lingerUsing);
+    int createListenFd(bool lingerUsing, bool reusePort);
     void serverShutdown();
-    void setNonBlocking(int fd);
 
     void depictServerInit(bool lingerUsing, int threadNums, int sqlConnNums, int loggerQueSize) const;
     void depictServerStatus() const;
@@ -71,4 +64,4 @@ private:
     static void interruptionHandler(int signal);
 };
 
-#endif  // _SERVER_H
\ No newline at end of file
+#endif  // _SERVER_H
@@ -0,0 +1,486 @@
+#include "uringReactor.h"
+
+const int UringReactor::MAX_FD = 65535;   // 最大的连接数
+
+UringReactor::UringReactor(int timeoutMS, ThreadPool* dbPool)
+    :m_timeoutMS(timeoutMS), m_listenFd(-1), m_wakeupCnt(0), m_dbPool(dbPool) {
+    m_uringer = std::make_unique<Uringer>(URING_ENTRIES);
+    m_timer = std::make_unique<HeapTimer>();
+    m_users = std::make_unique<ConnTable>(MAX_FD + 1);
+    m_states.resize(m_users->capacity());
+}
+
+/**
+ * @brief 注册接收缓冲区，挂载multishot accept与唤醒读
+ *
+ * @param listenFd 已完成listen的fd
+ * @return true  成功
+ * @return false 内核不支持或资源不足
+ */
+bool UringReactor::init(int listenFd) {
+    m_listenFd = listenFd;
+
+    if (!m_uringer->valid()) {
+        Logger::Instance()->LOG_ERROR("io_uring setup error");
+        return false;
+    }
+
+    if (!m_uringer->registerBufRing(URING_BUF_GROUP, URING_BUF_COUNT, URING_BUF_SIZE)) {
+        Logger::Instance()->LOG_ERROR("io_uring provided buffer ring register error");
+        return false;
+    }
+
+    if (m_wakeupFd < 0
+        || !m_uringer->prepAcceptMultishot(m_listenFd, packUserData(_ACCEPT, 0, m_listenFd))
+        || !m_uringer->prepRead(m_wakeupFd, &m_wakeupCnt, sizeof(m_wakeupCnt), packUserData(_WAKEUP, 0, m_wakeupFd))) {
+        Logger::Instance()->LOG_ERROR("io_uring submission error");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief 事件循环: 一次系统调用完成提交与等待
+ */
+void UringReactor::loop() {
+    int timeout_interval = -1;
+
+    while (1) {
+        if (m_timeoutMS > 0)
+            timeout_interval = m_timer->getNextTick();
+
+        int ret = m_uringer->submitAndWait(timeout_interval);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            std::string msg = "io_uring enter error: " + std::to_string(-ret);
+            Logger::Instance()->LOG_ERROR(msg);
+        }
+
+        struct io_uring_cqe* cqe = nullptr;
+        while ((cqe = m_uringer->peekCqe())) {
+            struct io_uring_cqe copied = *cqe;
+            m_uringer->cqeSeen();
+
+            handleCqe(copied);
+        }
+    }
+}
+
+uint64_t UringReactor::packUserData(URING_OP op, uint16_t gen, int fd) {
+    return (static_cast<uint64_t>(op) << 56) | (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd);
+}
+
+/**
+ * @brief 分发完成事件
+ *
+ * @param cqe
+ */
+void UringReactor::handleCqe(const struct io_uring_cqe& cqe) {
+    const URING_OP op = static_cast<URING_OP>(cqe.user_data >> 56);
+    const uint16_t gen = static_cast<uint16_t>(cqe.user_data >> 32);
+    const int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+
+    switch (op) {
+        case _ACCEPT:
+            handleAccept(cqe.res, cqe.flags);
+            return;
+        case _WAKEUP:
+            handleWakeup(cqe.res);
+            return;
+        case _CANCEL:
+            return;
+        default:
+            break;
+    }
+
+    // 连接已关闭且fd被复用，丢弃旧的完成事件
+    if (m_states[fd].gen != gen) {
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+            m_uringer->recycleBuf(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        return;
+    }
+
+    HttpConn* conn = m_users->get(fd);
+
+    if (op == _RECV)
+        handleRecv(conn, cqe.res, cqe.flags);
+    else if (op == _WRITE)
+        handleWrite(conn, cqe.res);
+    else if (op == _CLOSE)
+        handleClose(conn, cqe.res);
+    else if (op == _POLLOUT)
+        handlePollOut(conn, cqe.res);
+}
+
+/**
+ * @brief 处理新连接事务
+ *
+ * @param res   新连接fd或错误码
+ * @param flags
+ */
+void UringReactor::handleAccept(int res, uint32_t flags) {
+    // multishot 结束时需重新挂载
+    if (!(flags & IORING_CQE_F_MORE) && res != -EINVAL)
+        m_uringer->prepAcceptMultishot(m_listenFd, packUserData(_ACCEPT, 0, m_listenFd));
+
+    if (res < 0) {
+        std::string msg = "io_uring accept error: " + std::to_string(-res);
+        Logger::Instance()->LOG_ERROR(msg);
+        return;
+    }
+
+    const int fd = res;
+    HttpConn* conn = nullptr;
+
+    if (HttpConn::s_usersCount >= MAX_FD || !(conn = m_users->acquire(fd))) {
+        const char* msg = "The connection was interrupted due to server overload";
+        send(fd, msg, strlen(msg), MSG_DONTWAIT);
+        close(fd);
+
+        Logger::Instance()->LOG_WARNING("server busy");
+        return;
+    }
+
+    // fd已被内核复用，说明旧连接的close已执行，其完成事件可能尚未处理
+    if (!conn->isClosed())
+        _doRelease(conn);
+
+    struct sockaddr_in addr = { 0 };
+    socklen_t len = sizeof(addr);
+    getpeername(fd, (struct sockaddr*)&addr, &len);
+
+    conn->init(fd, addr);
+
+    ConnState& state = m_states[fd];
+
+    if (m_timeoutMS > 0)
+        m_timer->add(fd, m_timeoutMS, std::bind(&UringReactor::_doClose, this, conn));
+
+    m_uringer->prepRecvMultishot(fd, URING_BUF_GROUP, packUserData(_RECV, state.gen, fd));
+
+    std::string msg = "Client - " + std::to_string(fd) + " conn in";
+    Logger::Instance()->LOG_INFO(msg);
+    msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
+    Logger::Instance()->LOG_INFO(msg);
+}
+
+/**
+ * @brief 处理读取事务: 数据已由内核写入提供的缓冲区
+ *
+ * @param conn  ptr
+ * @param res   读取长度或错误码
+ * @param flags
+ */
+void UringReactor::handleRecv(HttpConn* conn, int res, uint32_t flags) {
+    const int fd = conn->getFd();
+    ConnState& state = m_states[fd];
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+
+        if (res > 0 && !state.closing) {
+            if (state.deferred || conn->isDeferred())    // 待执行的请求指向读缓冲区，暂存
+                state.stash.append(m_uringer->bufPtr(bid), res);
+            else
+                conn->appendRead(m_uringer->bufPtr(bid), res);
+        }
+
+        m_uringer->recycleBuf(bid);
+    }
+
+    if (state.closing || state.closeRequested || res == -ECANCELED)
+        return;
+
+    if (res == 0 || (res < 0 && res != -ENOBUFS)) {    // 对端关闭或出错
+        _doClose(conn);
+        return;
+    }
+
+    // 缓冲区耗尽或multishot结束，重新挂载
+    if (!(flags & IORING_CQE_F_MORE))
+        m_uringer->prepRecvMultishot(fd, URING_BUF_GROUP, packUserData(_RECV, state.gen, fd));
+
+    if (res > 0) {
+        extendExpire(conn);
+
+        if (!state.writing && !state.deferred)
+            _doProcess(conn);
+    }
+}
+
+/**
+ * @brief 处理写出完成事务
+ *
+ * @param conn ptr
+ * @param res  写出长度或错误码
+ */
+void UringReactor::handleWrite(HttpConn* conn, int res) {
+    ConnState& state = m_states[conn->getFd()];
+    const bool linked = state.linkedClose;
+
+    state.writing = false;
+    state.linkedClose = false;
+
+    if (state.closing)
+        return;
+
+    // 写出失败或被取消时，链接的close也随之取消
+    if (res < 0) {
+        _doClose(conn);
+        return;
+    }
+
+    conn->hasWritten(res);
+
+    if (conn->bytesToSend() > 0) {  // 未写完(链接的close已因短写被取消)
+        if (state.closeRequested)
+            _doClose(conn);
+        else
+            _doWrite(conn);
+        return;
+    }
+
+    if (linked) {   // 链接的close随即执行
+        state.closing = true;
+        return;
+    }
+
+    _doWriteDone(conn);
+}
+
+/**
+ * @brief 处理关闭完成事务
+ *
+ * @param conn ptr
+ * @param res
+ */
+void UringReactor::handleClose(HttpConn* conn, int res) {
+    if (res == -ECANCELED)  // 链接的close因短写被取消，由写出流程继续处理
+        return;
+
+    _doRelease(conn);
+}
+
+/**
+ * @brief socket可写，继续sendfile
+ *
+ * @param conn ptr
+ * @param res  就绪事件或错误码
+ */
+void UringReactor::handlePollOut(HttpConn* conn, int res) {
+    ConnState& state = m_states[conn->getFd()];
+    state.writing = false;
+
+    if (state.closing)
+        return;
+
+    if (res < 0 || state.closeRequested) {
+        _doClose(conn);
+        return;
+    }
+
+    _doSendFile(conn);
+}
+
+/**
+ * @brief 执行其他线程投递的任务，并重新挂载唤醒读
+ *
+ * @param res
+ */
+void UringReactor::handleWakeup(int res) {
+    m_uringer->prepRead(m_wakeupFd, &m_wakeupCnt, sizeof(m_wakeupCnt), packUserData(_WAKEUP, 0, m_wakeupFd));
+
+    runPendingTasks();
+}
+
+/**
+ * @brief 解析readBuffer，组装响应后立即提交写出
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doProcess(HttpConn* conn) {
+    if (!conn->isDeferred() && conn->process())
+        _doWrite(conn);
+    else if (conn->isDeferred())
+        _doDefer(conn);     // 已组装的响应写完后才会到这里
+}
+
+/**
+ * @brief 提交写出；非长连接时链接close，写完即关闭
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doWrite(HttpConn* conn) {
+    const int fd = conn->getFd();
+    ConnState& state = m_states[fd];
+
+    int iovCnt = 0;
+    const struct iovec* iov = conn->writeIov(&iovCnt);
+
+    if (iovCnt == 0) {
+        _doSendFile(conn);  // 下一段为经sendfile发送的文件片段
+        return;
+    }
+
+    state.writing = true;
+
+    if (conn->pendingFileBytes()) {
+        // 响应头带MSG_MORE，与随后sendfile的文件体合并成报文
+        state.msg = {};
+        state.msg.msg_iov = const_cast<struct iovec*>(iov);
+        state.msg.msg_iovlen = iovCnt;
+
+        m_uringer->prepSendmsg(fd, &state.msg, MSG_MORE | MSG_NOSIGNAL, packUserData(_WRITE, state.gen, fd));
+        return;
+    }
+
+    if (conn->isKeepAlive() || state.closeRequested) {
+        m_uringer->prepWritev(fd, iov, iovCnt, packUserData(_WRITE, state.gen, fd));
+        return;
+    }
+
+    state.linkedClose = true;
+    m_uringer->prepCancelFd(fd, packUserData(_CANCEL, state.gen, fd), IOSQE_IO_HARDLINK);   // 先取消multishot recv
+    m_uringer->prepWritev(fd, iov, iovCnt, packUserData(_WRITE, state.gen, fd), IOSQE_IO_LINK);
+    m_uringer->prepClose(fd, packUserData(_CLOSE, state.gen, fd));
+}
+
+/**
+ * @brief 发送大文件片段，直到轮到下一段向量、全部发完或socket写满
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doSendFile(HttpConn* conn) {
+    const int fd = conn->getFd();
+
+    while (true) {
+        int iovCnt = 0;
+        conn->writeIov(&iovCnt);
+
+        if (iovCnt > 0) {
+            _doWrite(conn);
+            return;
+        }
+
+        if (conn->bytesToSend() == 0) {
+            _doWriteDone(conn);
+            return;
+        }
+
+        int sendErrno = 0;
+        if (conn->sendFile(&sendErrno) < 0) {
+            if (sendErrno != EAGAIN) {
+                _doClose(conn);
+                return;
+            }
+
+            m_states[fd].writing = true;
+            m_uringer->prepPollOut(fd, packUserData(_POLLOUT, m_states[fd].gen, fd));
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 本批响应写完: 关闭非长连接，或继续处理写出期间已读入的请求
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doWriteDone(HttpConn* conn) {
+    if (m_states[conn->getFd()].closeRequested || !conn->isKeepAlive()) {
+        _doClose(conn);
+        return;
+    }
+
+    extendExpire(conn);
+    _doProcess(conn);
+}
+
+/**
+ * @brief 关闭连接: 取消fd上的在途请求后关闭
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doClose(HttpConn* conn) {
+    const int fd = conn->getFd();
+    ConnState& state = m_states[fd];
+
+    if (conn->isClosed() || state.closing)
+        return;
+
+    // 处理函数执行中，或在途writev链接了close: 待其完成后再关闭
+    if (state.deferred || state.linkedClose) {
+        if (!state.closeRequested && state.linkedClose)
+            m_uringer->prepCancelFd(fd, packUserData(_CANCEL, state.gen, fd));
+
+        state.closeRequested = true;
+        return;
+    }
+
+    state.closing = true;
+    m_uringer->prepCancelFd(fd, packUserData(_CANCEL, state.gen, fd), IOSQE_IO_HARDLINK);
+    m_uringer->prepClose(fd, packUserData(_CLOSE, state.gen, fd));
+}
+
+/**
+ * @brief 释放连接: fd已关闭，推进连接代数使其残留的完成事件失效
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doRelease(HttpConn* conn) {
+    const int fd = conn->getFd();
+    ConnState& state = m_states[fd];
+
+    state.gen++;
+    state.writing = state.linkedClose = state.closing = false;
+    state.deferred = state.closeRequested = false;
+    state.stash.clear();
+
+    if (conn->doClose(true)) {
+        std::string msg = "Client - " + std::to_string(fd) + " conn close";
+        Logger::Instance()->LOG_INFO(msg);
+        msg = "current online users: " + std::to_string(HttpConn::s_usersCount);
+        Logger::Instance()->LOG_INFO(msg);
+    }
+}
+
+/**
+ * @brief 将阻塞处理函数交给数据库线程执行，完成后回到本循环继续处理
+ *
+ * @param conn ptr
+ */
+void UringReactor::_doDefer(HttpConn* conn) {
+    const int fd = conn->getFd();
+    m_states[fd].deferred = true;
+
+    m_dbPool->addTask([this, conn, fd] {
+        conn->runDeferred();
+
+        queueInLoop([this, conn, fd] {
+            ConnState& state = m_states[fd];
+            state.deferred = false;
+
+            if (state.closeRequested) {
+                _doClose(conn);
+                return;
+            }
+
+            _doProcess(conn);   // 先组装该请求的响应，再取回暂存的数据
+
+            if (!state.stash.empty() && !conn->isDeferred()) {
+                conn->appendRead(state.stash.data(), state.stash.size());
+                state.stash.clear();
+            }
+        });
+    });
+}
+
+/**
+ * @brief 延长连接活动时间
+ *
+ * @param conn ptr
+ */
+void UringReactor::extendExpire(HttpConn* conn) {
+    if (m_timeoutMS > 0)
+        m_timer->adjust(conn->getFd(), m_timeoutMS);
+}
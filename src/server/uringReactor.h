@@ -0,0 +1,98 @@
+/*
+    基于io_uring的事件循环
+    multishot accept + provided buffer multishot recv + writev(链接close)，请求经同一提交队列批量提交
+    大文件体在循环线程内以非阻塞sendfile发送，socket写满时挂载poll等待可写
+*/
+
+#ifndef _URING_REACTOR_H
+#define _URING_REACTOR_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "eventLoop.h"
+#include "uringer.h"
+#include "connTable.h"
+#include "../pool/threadPool.h"
+#include "../timer/heapTimer.h"
+#include "../logger/logger.h"
+
+#define URING_ENTRIES       1024
+#define URING_BUF_GROUP     0
+#define URING_BUF_COUNT     1024    // 须为2的幂
+#define URING_BUF_SIZE      4096
+
+class UringReactor: public EventLoop {
+public:
+    /**
+     * @param timeoutMS    连接超时时间
+     * @param threadPool   线程池，只处理阻塞事务(数据库)
+     */
+    UringReactor(int timeoutMS, ThreadPool* dbPool);
+    ~UringReactor() = default;
+
+public:
+    bool init(int listenFd) override;
+    void loop() override;
+
+private:
+    enum URING_OP {
+        _ACCEPT,
+        _RECV,
+        _WRITE,
+        _CLOSE,
+        _CANCEL,
+        _POLLOUT,
+        _WAKEUP
+    };
+
+    // 连接在本循环中的状态
+    struct ConnState {
+        uint16_t gen;           // 连接代数，fd复用后旧的完成事件据此丢弃
+        bool writing;           // writev 在途
+        bool linkedClose;       // 在途的 writev 链接了 close
+        bool closing;           // close 已提交
+        bool deferred;          // 处理函数在数据库线程中执行
+        bool closeRequested;    // 处理中途被要求关闭
+        std::string stash;      // 处理函数待执行或执行期间收到的数据
+        struct msghdr msg;      // 在途sendmsg的消息头，须存活至完成
+    };
+
+    int m_timeoutMS;
+    int m_listenFd;
+    uint64_t m_wakeupCnt;
+
+    std::unique_ptr<Uringer> m_uringer;
+    std::unique_ptr<HeapTimer> m_timer;
+    ThreadPool* m_dbPool;
+    std::unique_ptr<ConnTable> m_users;   // 各reactor独立持有，连接只在所属循环内被访问
+    std::vector<ConnState> m_states;
+
+    static const int MAX_FD;
+
+private:
+    static uint64_t packUserData(URING_OP op, uint16_t gen, int fd);
+
+    void handleCqe(const struct io_uring_cqe& cqe);
+    void handleAccept(int res, uint32_t flags);
+    void handleRecv(HttpConn* conn, int res, uint32_t flags);
+    void handleWrite(HttpConn* conn, int res);
+    void handleClose(HttpConn* conn, int res);
+    void handlePollOut(HttpConn* conn, int res);
+    void handleWakeup(int res);
+
+    void extendExpire(HttpConn* conn);
+
+    void _doProcess(HttpConn* conn);
+    void _doWrite(HttpConn* conn);
+    void _doSendFile(HttpConn* conn);
+    void _doWriteDone(HttpConn* conn);
+    void _doClose(HttpConn* conn);
+    void _doRelease(HttpConn* conn);
+    void _doDefer(HttpConn* conn);
+};
+
+#endif  // _URING_REACTOR_H
@@ -0,0 +1,352 @@
+#include "uringer.h"
+
+Uringer::Uringer(unsigned entries)
+    :m_ring_fd(-1), m_features(0), m_sq_ptr(MAP_FAILED), m_sq_size(0), m_sqes(nullptr), m_sqes_size(0),
+     m_sqe_tail(0), m_submitted_tail(0), m_cq_ptr(MAP_FAILED), m_cq_size(0),
+     m_buf_ring(nullptr), m_buf_tail(nullptr), m_buf_ring_size(0), m_buf_count(0), m_buf_size(0) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // 完成队列容量设为提交队列的4倍，multishot请求会持续产生完成事件
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    m_ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (m_ring_fd < 0)
+        return;
+
+    m_features = params.features;
+
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (m_features & IORING_FEAT_SINGLE_MMAP)
+        m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) {
+        close(m_ring_fd);
+        m_ring_fd = -1;
+        return;
+    }
+
+    if (m_features & IORING_FEAT_SINGLE_MMAP)
+        m_cq_ptr = m_sq_ptr;
+    else
+        m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+
+    if (m_cq_ptr == MAP_FAILED || sqes == MAP_FAILED) {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, m_sqes_size);
+        if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+            munmap(m_cq_ptr, m_cq_size);
+        munmap(m_sq_ptr, m_sq_size);
+
+        m_sq_ptr = m_cq_ptr = MAP_FAILED;
+        close(m_ring_fd);
+        m_ring_fd = -1;
+        return;
+    }
+
+    char* sq = static_cast<char*>(m_sq_ptr);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+    m_sqe_tail = m_submitted_tail = *m_sq_tail;
+
+    char* cq = static_cast<char*>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+Uringer::~Uringer() {
+    if (m_ring_fd < 0)
+        return;
+
+    if (m_buf_ring)
+        munmap(m_buf_ring, m_buf_ring_size);
+
+    munmap(m_sqes, m_sqes_size);
+    if (m_cq_ptr != m_sq_ptr)
+        munmap(m_cq_ptr, m_cq_size);
+    munmap(m_sq_ptr, m_sq_size);
+
+    close(m_ring_fd);
+}
+
+/**
+ * @brief 环是否可用(内核需支持EXT_ARG，即 >= 5.11)
+ */
+bool Uringer::valid() const {
+    return m_ring_fd >= 0 && (m_features & IORING_FEAT_EXT_ARG);
+}
+
+/**
+ * @brief 注册接收缓冲区环(provided buffers, 内核 >= 5.19)
+ *
+ * @param bgid  缓冲区组id
+ * @param count 缓冲区数量，须为2的幂
+ * @param size  单个缓冲区大小
+ * @return true  成功
+ * @return false 失败
+ */
+bool Uringer::registerBufRing(uint16_t bgid, unsigned count, unsigned size) {
+    assert(count > 0 && (count & (count - 1)) == 0 && count <= 32768);
+
+    m_buf_ring_size = count * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, m_buf_ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED)
+        return false;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = count;
+    reg.bgid = bgid;
+
+    if (syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, m_buf_ring_size);
+        return false;
+    }
+
+    // C++下 io_uring_buf_ring 中柔性数组的布局与C不一致，直接按 io_uring_buf 数组访问
+    m_buf_ring = static_cast<struct io_uring_buf*>(ring);
+    m_buf_tail = &m_buf_ring[0].resv;     // 环尾与首个缓冲区描述的resv字段重叠
+    m_buf_count = count;
+    m_buf_size = size;
+    m_bufs.resize(static_cast<size_t>(count) * size);
+
+    *m_buf_tail = 0;
+    for (unsigned bid = 0; bid < count; bid++)
+        recycleBuf(bid);
+
+    return true;
+}
+
+char* Uringer::bufPtr(uint16_t bid) const {
+    assert(bid < m_buf_count);
+
+    return const_cast<char*>(m_bufs.data()) + static_cast<size_t>(bid) * m_buf_size;
+}
+
+/**
+ * @brief 归还缓冲区给内核
+ *
+ * @param bid 缓冲区id
+ */
+void Uringer::recycleBuf(uint16_t bid) {
+    uint16_t tail = *m_buf_tail;
+    struct io_uring_buf* buf = &m_buf_ring[tail & (m_buf_count - 1)];
+
+    buf->addr = reinterpret_cast<uint64_t>(bufPtr(bid));
+    buf->len = m_buf_size;
+    buf->bid = bid;
+
+    __atomic_store_n(m_buf_tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 获取空闲sqe，提交队列满时先提交已有请求
+ */
+struct io_uring_sqe* Uringer::getSqe() {
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+
+    if (m_sqe_tail - head > *m_sq_mask) {
+        submitAndWait(0);
+        head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+
+        if (m_sqe_tail - head > *m_sq_mask)
+            return nullptr;
+    }
+
+    unsigned index = m_sqe_tail & *m_sq_mask;
+    struct io_uring_sqe* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    m_sq_array[index] = index;
+    m_sqe_tail++;
+
+    return sqe;
+}
+
+bool Uringer::prepAcceptMultishot(int listenFd, uint64_t userData) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+bool Uringer::prepRecvMultishot(int fd, uint16_t bgid, uint64_t userData) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+bool Uringer::prepRead(int fd, void* buf, unsigned len, uint64_t userData) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = static_cast<uint64_t>(-1);   // 使用文件当前偏移
+    sqe->user_data = userData;
+
+    return true;
+}
+
+/**
+ * @param flags IOSQE_IO_LINK 等，与后续请求链接
+ */
+bool Uringer::prepWritev(int fd, const struct iovec* iov, int iovCnt, uint64_t userData, uint8_t flags) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = iovCnt;
+    sqe->off = static_cast<uint64_t>(-1);
+    sqe->flags = flags;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+bool Uringer::prepSendmsg(int fd, const struct msghdr* msg, unsigned msgFlags, uint64_t userData, uint8_t flags) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = msgFlags;
+    sqe->flags = flags;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+/**
+ * @brief 单次等待fd可写
+ */
+bool Uringer::prepPollOut(int fd, uint64_t userData) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+/**
+ * @brief 取消fd上所有未完成的请求(如multishot recv)，内核 >= 5.19
+ */
+bool Uringer::prepCancelFd(int fd, uint64_t userData, uint8_t flags) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->flags = flags;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+bool Uringer::prepClose(int fd, uint64_t userData) {
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = userData;
+
+    return true;
+}
+
+/**
+ * @brief 提交所有已填充请求，并等待至少一个完成事件
+ *
+ * @param timeout 等待毫秒数，-1为无限等待，0为不等待
+ * @return int 小于0为错误码(-ETIME 表示超时)
+ */
+int Uringer::submitAndWait(int timeout) {
+    unsigned toSubmit = m_sqe_tail - m_submitted_tail;
+    __atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+    m_submitted_tail = m_sqe_tail;
+
+    if (timeout == 0)
+        return toSubmit ? enter(toSubmit, 0, 0, nullptr, 0) : 0;
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+
+    if (timeout > 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    return enter(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+int Uringer::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    int ret = syscall(__NR_io_uring_enter, m_ring_fd, toSubmit, minComplete, flags, arg, argSize);
+
+    return ret < 0 ? -errno : ret;
+}
+
+/**
+ * @brief 查看队首完成事件
+ *
+ * @return struct io_uring_cqe* 无事件返回nullptr
+ */
+struct io_uring_cqe* Uringer::peekCqe() {
+    unsigned head = *m_cq_head;
+
+    if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+        return nullptr;
+
+    return &m_cqes[head & *m_cq_mask];
+}
+
+void Uringer::cqeSeen() {
+    __atomic_store_n(m_cq_head, *m_cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,82 @@
+/*
+    io_uring操作封装(直接使用系统调用，不依赖liburing)
+*/
+
+#ifndef _URINGER_H
+#define _URINGER_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <unistd.h>     // close
+#include <poll.h>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+class Uringer {
+public:
+    Uringer(unsigned entries = 1024);
+    ~Uringer();
+
+    bool valid() const;
+    bool registerBufRing(uint16_t bgid, unsigned count, unsigned size);
+
+    bool prepAcceptMultishot(int listenFd, uint64_t userData);
+    bool prepRecvMultishot(int fd, uint16_t bgid, uint64_t userData);
+    bool prepRead(int fd, void* buf, unsigned len, uint64_t userData);
+    bool prepWritev(int fd, const struct iovec* iov, int iovCnt, uint64_t userData, uint8_t flags = 0);
+    bool prepSendmsg(int fd, const struct msghdr* msg, unsigned msgFlags, uint64_t userData, uint8_t flags = 0);
+    bool prepPollOut(int fd, uint64_t userData);
+    bool prepCancelFd(int fd, uint64_t userData, uint8_t flags = 0);
+    bool prepClose(int fd, uint64_t userData);
+
+    int submitAndWait(int timeout);
+    struct io_uring_cqe* peekCqe();
+    void cqeSeen();
+
+    char* bufPtr(uint16_t bid) const;
+    void recycleBuf(uint16_t bid);
+
+private:
+    int m_ring_fd;
+    unsigned m_features;
+
+    // 提交队列
+    void* m_sq_ptr;
+    size_t m_sq_size;
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned* m_sq_mask;
+    unsigned* m_sq_array;
+    struct io_uring_sqe* m_sqes;
+    size_t m_sqes_size;
+    unsigned m_sqe_tail;        // 本地已填充但尚未提交的尾部
+    unsigned m_submitted_tail;  // 已提交至内核的尾部
+
+    // 完成队列
+    void* m_cq_ptr;
+    size_t m_cq_size;
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    unsigned* m_cq_mask;
+    struct io_uring_cqe* m_cqes;
+
+    // 提供给内核的接收缓冲区环
+    struct io_uring_buf* m_buf_ring;
+    uint16_t* m_buf_tail;
+    size_t m_buf_ring_size;
+    unsigned m_buf_count;
+    unsigned m_buf_size;
+    std::vector<char> m_bufs;
+
+    struct io_uring_sqe* getSqe();
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize);
+};
+
+#endif  // _URINGER_H
@@ -1,8 +1,17 @@
 #include "logger/devices.h"
+#ifdef WITH_MYSQL
 #include "pool/sqlConnPool.h"
+#endif
 #include "pool/threadPool.h"
 #include "timer/heapTimer.h"
 #include "logger/logger.h"
+#include "http/httpRequest.h"
+#include "http/httpScanner.h"
+#include "http/router.h"
+#include "http/fileCache.h"
+#include "auth/authStore.h"
+#include "auth/bloomFilter.h"
+#include "pool/circuitBreaker.h"
 #include <cassert>
 #include <chrono>
 #include <cstring>
@@ -11,12 +20,23 @@
 #include <unistd.h>
 #include <string>
 #include <vector>
+#include <regex>
+#include <thread>
+#include <fstream>
+#include <sys/stat.h>
 
 #define SQLCONNPOOL_TEST    0   // 数据库连接池测试
 #define THREADPOOL_TEST     0   // 线程池测试
 #define HEAPTIMER_TEST      0   // 最小时间堆测试
 #define BLOCKINGDEQUE_TEST  0   // 阻塞队列测试
 #define LOGGER_TEST         0   // 日志测试
+#define HTTPPARSER_TEST     0   // 请求解析性能测试(状态机 vs 正则)
+#define SCANNER_TEST        0   // 字节扫描性能测试(SIMD vs 原实现)
+#define ROUTER_TEST         0   // 路由查找测试(前缀树 vs 逐条比较)
+#define AUTHSTORE_TEST      0   // 账户存储后端对比(内存 / SQLite)
+#define BLOOMFILTER_TEST    0   // 用户名过滤器误判率与查询耗时
+#define BREAKER_TEST        0   // 熔断器状态转换
+#define FILECACHE_TEST      0   // 文件缓存随目录改名失效
 
 void func() {
     std::cout<< "hello: "<< std::endl;
@@ -41,8 +61,98 @@ private:
     std::chrono::duration<float> duration;
 };
 
+#if HTTPPARSER_TEST
+// 统计堆分配次数，确认解析GET请求不分配内存
+static size_t s_allocs = 0;
+
+void* operator new(size_t size) {
+    s_allocs++;
+    if (void* ptr = malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// 原先基于正则的逐行解析，作为对照
+bool regexParse(const std::string& request) {
+    std::string method, path, version;
+    std::unordered_map<std::string, std::string> headers;
+
+    size_t pos = 0;
+    bool requestLine = true;
+
+    while (pos < request.size()) {
+        size_t lineEnd = request.find("\r\n", pos);
+        if (lineEnd == std::string::npos)
+            return false;
+
+        std::string lineStr = request.substr(pos, lineEnd - pos);
+        pos = lineEnd + 2;
+
+        if (requestLine) {
+            std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+            std::smatch matchRes;
+            if (!regex_match(lineStr, matchRes, patten))
+                return false;
+
+            method = matchRes[1];
+            path = matchRes[2];
+            version = matchRes[3];
+            requestLine = false;
+            continue;
+        }
+
+        if (lineStr.empty())
+            return true;
+
+        std::regex pattern("^([^:]*): ?(.*)$");
+        std::smatch matchRes;
+        if (regex_match(lineStr, matchRes, pattern))
+            headers[matchRes[1]] = matchRes[2];
+    }
+
+    return false;
+}
+#endif
+
+#if SCANNER_TEST
+// 原先的逐字符解码，作为对照
+std::string charUrlDecode(const std::string& body) {
+    auto fromChar = [](char ch) -> char {
+        if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 10;
+        if (ch >= 'a' && ch <= 'z') return ch - 'a' + 10;
+        return ch - '0';
+    };
+
+    std::string tmp = "";
+    int length = body.length();
+
+    for (int i = 0; i < length; i++) {
+        char ch = body[i];
+
+        if (ch == '+')
+            tmp += ' ';
+        else if (ch == '%' && i + 2 < length) {
+            char high = fromChar(body[++i]);
+            char low = fromChar(body[++i]);
+            tmp += high * 16 + low;
+        } else
+            tmp += ch;
+    }
+
+    return tmp;
+}
+#endif
+
 int main() {
-#if SQLCONNPOOL_TEST
+#if SQLCONNPOOL_TEST && defined(WITH_MYSQL)
     {
         SqlConnInfo sci({
             3306,
@@ -52,8 +162,15 @@ int main() {
             "words"
         });
 
-        SqlConnPool scp(12, &sci);
-        std::cout<< scp.getConn()<< std::endl;
+        SqlConnPool::Instance()->init(2, 12, &sci);
+
+        {
+            Timer timer;
+            SqlConnGuard conn(100);
+            std::cout<< conn.get()<< "   conns: "<< SqlConnPool::Instance()->getConnNums()<< std::endl;
+        }
+
+        SqlConnPool::Instance()->destoryPool();
     }
 #endif
 
@@ -156,6 +273,410 @@ int main() {
         // Logger::Instance()->write(_INFO, "aaa");
     }
 #endif
+#if HTTPPARSER_TEST
+    {
+        const std::string request =
+            "GET /picture.html HTTP/1.1\r\n"
+            "Host: 127.0.0.1:7777\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/111.0 Safari/537.36\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+            "Accept-Encoding: gzip, deflate, br\r\n"
+            "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+            "Connection: keep-alive\r\n"
+            "Cache-Control: max-age=0\r\n"
+            "\r\n";
+        const int rounds = 100000;
+
+        {
+            Timer timer;
+            int ok = 0;
+
+            for (int i = 0; i < rounds; i++)
+                ok += regexParse(request);
+
+            std::cout<< "regex parser: "<< ok<< " requests\n";
+        }
+
+        {
+            Timer timer;
+            int ok = 0;
+            HttpRequest httpRequest;
+            Buffer buff;
+
+            httpRequest.init();
+            buff.append(request);
+            buff.retrieveAll();
+
+            size_t allocs = s_allocs;
+            for (int i = 0; i < rounds; i++) {
+                buff.append(request);
+                ok += httpRequest.parse(buff);
+            }
+
+            std::cout<< "state machine parser: "<< ok<< " requests, "<< s_allocs - allocs<< " allocations\n";
+        }
+
+        {
+            // 逐字节送入，验证跨读断点续解析
+            HttpRequest httpRequest;
+            Buffer buff;
+            bool done = false;
+
+            httpRequest.init();
+            for (char ch : request) {
+                buff.append(&ch, 1);
+                done = httpRequest.parse(buff);
+            }
+
+            std::cout<< "byte by byte: "<< done<< " "<< httpRequest.path()<< " "<< httpRequest.version()<< std::endl;
+        }
+
+        {
+            // 分块请求体: 缓存于缓冲区 / 流式交付
+            const std::string chunked =
+                "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\nX-Trailer: 1\r\n\r\n";
+
+            size_t streamed = 0;
+            bool finished = false;
+            HttpRequest::registerBodyHandler("/upload", [&](const HttpRequest&, std::string_view data, bool last) {
+                streamed += data.size();
+                finished = last;
+                return true;
+            });
+
+            for (const std::string& path : { std::string("/echo"), std::string("/upload") }) {
+                std::string request = chunked;
+                request.replace(5, 5, path);
+
+                HttpRequest httpRequest;
+                Buffer buff;
+                bool done = false;
+
+                httpRequest.init();
+                for (char ch : request) {
+                    buff.append(&ch, 1);
+                    done = httpRequest.parse(buff);
+                }
+
+                std::cout<< path<< " chunked: "<< done<< " body \""<< httpRequest.body()<< "\" length "<< httpRequest.bodyLength()
+                    << " left "<< buff.readableBytes()<< std::endl;
+            }
+
+            std::cout<< "streamed: "<< streamed<< " finished: "<< finished<< std::endl;
+        }
+    }
+#endif
+
+#if SCANNER_TEST
+    {
+        const std::string line = "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/111.0 Safari/537.36\r\n";
+        std::string headers;
+        for (int i = 0; i < 64; i++)
+            headers += line;
+
+        const std::string form = "username=%E5%BC%A0%E4%B8%89+yfd&password=hello+world+this+is+a+long+password+value&isLogin=1&comment="
+            + std::string(512, 'a') + "+%21%40%23" + std::string(512, 'b');
+        const int rounds = 100000;
+        const char CRLF[] = "\r\n";
+
+        std::cout<< "isa: "<< HttpScanner::isa()<< std::endl;
+
+        // 结果须与标量实现一致
+        {
+            srand(7);
+            std::string sample(4096, 0);
+            for (char& ch : sample)
+                ch = "aZ09 :\t\r\n%+\x7f\x01\xff-"[rand() % 15];
+
+            const char* begin = sample.data();
+            const char* end = begin + sample.size();
+
+            std::vector<const char*> simd, scalar;
+            for (const char* p = begin; p < end; p++) {
+                simd.push_back(HttpScanner::findLineEnd(p, end));
+                simd.push_back(HttpScanner::findTokenEnd(p, end));
+                simd.push_back(HttpScanner::findHeaderNameEnd(p, end));
+                simd.push_back(HttpScanner::findHeaderValueEnd(p, end));
+            }
+            std::string decoded = sample;
+            decoded.resize(HttpScanner::urlDecode(decoded.data(), decoded.size()));
+
+            const char* isa = HttpScanner::isa();
+            HttpScanner::setSimdEnabled(false);
+
+            for (const char* p = begin; p < end; p++) {
+                scalar.push_back(HttpScanner::findLineEnd(p, end));
+                scalar.push_back(HttpScanner::findTokenEnd(p, end));
+                scalar.push_back(HttpScanner::findHeaderNameEnd(p, end));
+                scalar.push_back(HttpScanner::findHeaderValueEnd(p, end));
+            }
+            std::string expected = sample;
+            expected.resize(HttpScanner::urlDecode(expected.data(), expected.size()));
+
+            std::cout<< isa<< " matches scalar: "<< (simd == scalar && decoded == expected)<< std::endl;
+            HttpScanner::setSimdEnabled(true);
+        }
+
+        auto scanLines = [&](auto find) {
+            Timer timer;
+            size_t lines = 0;
+
+            for (int i = 0; i < rounds / 10; i++) {
+                const char* p = headers.data();
+                const char* end = p + headers.size();
+
+                while ((p = find(p, end)) != end) {
+                    lines++;
+                    p += 2;
+                }
+            }
+
+            std::cout<< "lines: "<< lines<< std::endl;
+        };
+
+        std::cout<< "std::search CRLF\n";
+        scanLines([&](const char* p, const char* end) { return std::search(p, end, CRLF, CRLF + 2); });
+
+        for (bool simd : { false, true }) {
+            HttpScanner::setSimdEnabled(simd);
+            std::cout<< "HttpScanner::findLineEnd ("<< HttpScanner::isa()<< ")\n";
+            scanLines(HttpScanner::findLineEnd);
+        }
+
+        {
+            std::cout<< "per-char decode\n";
+            Timer timer;
+            size_t total = 0;
+
+            for (int i = 0; i < rounds; i++)
+                total += charUrlDecode(form).size();
+
+            std::cout<< "bytes: "<< total<< std::endl;
+        }
+
+        for (bool simd : { false, true }) {
+            HttpScanner::setSimdEnabled(simd);
+            std::cout<< "in-place decode ("<< HttpScanner::isa()<< ")\n";
+
+            Timer timer;
+            size_t total = 0;
+            std::string buff;
+
+            for (int i = 0; i < rounds; i++) {
+                buff.assign(form);
+                total += HttpScanner::urlDecode(buff.data(), buff.size());
+            }
+
+            std::cout<< "bytes: "<< total<< std::endl;
+        }
+    }
+#endif
+
+#if ROUTER_TEST
+    {
+        const int routeNums = 1000;
+        const int rounds = 1000000;
+        Router router;
+        std::vector<std::string> paths;
+
+        router.init("/srv/static");
+        router.mount("/", "/srv/static");
+        router.mount("/files/", "/srv/files");
+        router.addPrefixRoute("GET", "/api", [](const HttpRequest&, std::string& page) { page = "/api.html"; return 200; });
+        router.addRoute("POST", "/login", [](const HttpRequest&, std::string& page) { page = "/welcome.html"; return 200; });
+
+        for (int i = 0; i < routeNums; i++) {
+            paths.push_back("/page/" + std::to_string(i) + "/detail");
+            router.addPage(paths.back(), "/detail.html");
+        }
+
+        auto route = [&router](const std::string& line) {
+            HttpRequest request;
+            Buffer buff;
+            Router::Target target;
+
+            request.init();
+            buff.append(line);
+            request.parse(buff);
+            router.dispatch(request, target);
+
+            std::cout<< line.substr(0, line.find('\r'))<< " -> "<< target.code<< ' '<< target.dir<< target.path<< std::endl;
+        };
+
+        route("GET /page/999/detail HTTP/1.1\r\n\r\n");
+        route("GET /index.html?from=1 HTTP/1.1\r\n\r\n");
+        route("GET /files/a/b.txt HTTP/1.1\r\n\r\n");
+        route("GET /files/../etc/passwd HTTP/1.1\r\n\r\n");
+        route("GET /api/users/1 HTTP/1.1\r\n\r\n");
+        route("GET /apix HTTP/1.1\r\n\r\n");
+        route("GET /login HTTP/1.1\r\n\r\n");
+        route("DELETE /page/1/detail HTTP/1.1\r\n\r\n");
+
+        const std::string line = "GET /page/999/detail HTTP/1.1\r\n\r\n";
+        HttpRequest request;
+        Buffer buff;
+        Router::Target target;
+
+        request.init();
+        buff.append(line);
+        request.parse(buff);
+
+        {
+            Timer timer;
+            size_t found = 0;
+
+            for (int i = 0; i < rounds / 100; i++) {
+                for (const std::string& path : paths) {
+                    if (path == request.path()) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+
+            std::cout<< "linear scan x"<< rounds / 100<< ": "<< found<< std::endl;
+        }
+
+        {
+            Timer timer;
+            size_t found = 0;
+
+            for (int i = 0; i < rounds; i++) {
+                router.dispatch(request, target);
+                found += target.code == 200;
+            }
+
+            std::cout<< "router x"<< rounds<< ": "<< found<< std::endl;
+        }
+    }
+#endif
+
+#if AUTHSTORE_TEST
+    {
+        const int threadNums = 8;
+        const int users = 2000;     // 每线程注册并登录的用户数
+
+        for (AuthConfig config : { AuthConfig(_AUTH_MEMORY), AuthConfig(_AUTH_SQLITE, "./authtest.db") }) {
+            unlink("./authtest.db");
+            if (!AuthStore::init(config))
+                continue;
+
+            std::atomic<int> ok(0);
+            std::cout<< AuthStore::Instance()->name()<< ": "<< threadNums * users<< " register + login\n";
+
+            {
+                Timer timer;
+                std::vector<std::thread> threads;
+
+                for (int t = 0; t < threadNums; t++) {
+                    threads.emplace_back([t, &ok] {
+                        for (int i = 0; i < users; i++) {
+                            std::string user = "user" + std::to_string(t) + "_" + std::to_string(i);
+                            ok += AuthStore::Instance()->add(user, "pw") == _AUTH_OK;
+                            ok += AuthStore::Instance()->verify(user, "pw") == _AUTH_OK;
+                        }
+                    });
+                }
+
+                for (auto& thread : threads)
+                    thread.join();
+            }
+
+            std::cout<< "succeeded: "<< ok<< std::endl;
+            AuthStore::destroy();
+        }
+
+        unlink("./authtest.db");
+    }
+#endif
+
+#if BLOOMFILTER_TEST
+    {
+        const int users = 1000000;
+        BloomFilter filter(1 << 24, 7);
+
+        for (int i = 0; i < users; i++)
+            filter.add("user" + std::to_string(i));
+
+        int missed = 0, falsePositive = 0;
+        {
+            Timer timer;
+            for (int i = 0; i < users; i++) {
+                missed += !filter.mayContain("user" + std::to_string(i));
+                falsePositive += filter.mayContain("guest" + std::to_string(i));
+            }
+        }
+
+        std::cout<< "missed: "<< missed<< "   false positive: "<< falsePositive * 100.0 / users<< "%"<< std::endl;
+    }
+#endif
+
+#if BREAKER_TEST
+    {
+        Logger::Instance()->init(MsgLevel::_INFO, LoggerDevice::_TERMINAL, "./log", ".log", 1024);
+
+        CircuitBreaker breaker;
+        bool trial = false;
+
+        for (int i = 0; i < BREAKER_CONSECUTIVE_FAILURES; i++) {
+            breaker.allow(trial);
+            breaker.record(trial, false, std::chrono::milliseconds(1));
+        }
+        std::cout<< "after failures: "<< breaker.state()<< "   allow: "<< breaker.allow(trial)<< std::endl;
+
+        sleep(BREAKER_OPEN_S);
+
+        for (int i = 0; i < BREAKER_HALF_OPEN_TRIALS; i++) {
+            std::cout<< "trial "<< i<< " allow: "<< breaker.allow(trial)<< "   state: "<< breaker.state()<< std::endl;
+            breaker.record(trial, true, std::chrono::milliseconds(1));
+        }
+        std::cout<< "after trials: "<< breaker.state()<< std::endl;
+    }
+#endif
+
+#if FILECACHE_TEST
+    {
+        Logger::Instance()->init(MsgLevel::_WARNING, LoggerDevice::_TERMINAL, "./log", ".log", 1024);
+
+        const std::string root = "/tmp/filecache_test";
+        auto writeFile = [](const std::string& path, const std::string& content) {
+            std::ofstream(path, std::ios::trunc)<< content;
+        };
+        auto readCached = [](const std::string& path) {
+            int err = 0;
+            std::shared_ptr<const CachedFile> file = FileCache::Instance()->acquire(path, &err);
+            return file ? std::string(file->data(), file->size()) : "error " + std::to_string(err);
+        };
+
+        system(("rm -rf " + root).c_str());
+        mkdir(root.c_str(), 0755);
+        mkdir((root + "/js").c_str(), 0755);
+        mkdir((root + "/js.new").c_str(), 0755);
+        writeFile(root + "/js/app.js", "old");
+        writeFile(root + "/js.new/app.js", "new");
+
+        FileCache::Instance()->init(root);
+        std::cout<< "before: "<< readCached(root + "/js/app.js")<< std::endl;
+
+        // 常见的整目录替换发布
+        rename((root + "/js").c_str(), (root + "/js.old").c_str());
+        rename((root + "/js.new").c_str(), (root + "/js").c_str());
+        usleep(100 * 1000);     // 等待监听线程处理事件
+
+        std::cout<< "after rename: "<< readCached(root + "/js/app.js")<< "   (expect new)"<< std::endl;
+        std::cout<< "old dir: "<< readCached(root + "/js.old/app.js")<< "   (expect old)"<< std::endl;
+
+        // 移入的目录按新路径监听
+        writeFile(root + "/js/app.js", "newer");
+        usleep(100 * 1000);
+        std::cout<< "after modify: "<< readCached(root + "/js/app.js")<< "   (expect newer)"<< std::endl;
+
+        FileCache::Instance()->destroy();
+        system(("rm -rf " + root).c_str());
+    }
+#endif
+
     int i = -1;
     if (i > strlen("hello")) {
         std::cout<< "wwwwwwwwwwwwwwwww\n";